@@ -9,6 +9,42 @@
 #include <algorithm>
 #include <chrono>
 #include <cstdlib>
+#include <string>
+#include <thread>
+#include <exception>
+#include <functional>
+#include <limits>
+#include <atomic>
+#include <array>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <bitset>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#else
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <cerrno>
+#define USAR_IO_URING 1
+#endif
+#endif
 
 using namespace std;
 
@@ -16,437 +52,4853 @@ const double PI = acos(-1.0);
 
 // Instrucciones de uso:
 // audio WAV
-// audio MONO
-// audio de 16 bits
-// solo lee desde la carpeta de audios
+// audio MONO o multicanal (cada canal se analiza por separado)
+// audio PCM de 8/16/24/32 bits, flotante (32/64 bits), A-law, mu-law o ADPCM
+// los nombres sin carpeta se leen desde la carpeta de audios; las rutas con carpeta se usan tal cual
+//
+// Uso: programa [archivo.wav ...] [--from segundos] [--to segundos]
+//   archivo.wav   audio dentro de la carpeta de audios (si se omite, se pregunta);
+//                 con varios archivos se procesan en lote. "-" lee de la entrada
+//                 estándar; las FIFO y tuberías se leen como flujo sin tocar el disco.
+//                 Un flujo se analiza cuando termina (EOF) o al llegar a --to, así
+//                 que una captura continua que no se cierra necesita --to (o
+//                 --series, que emite el BPM por ventanas sin esperar al final)
+//   --raw         la entrada es PCM sin cabecera; requiere --rate y admite
+//                 --channels (1 por defecto) y --sample-format s16|s32|f32 (s16)
+//   --threshold U umbral relativo de detección de picos (0.7 por defecto)
+//   --estimator E método para el BPM: picos (por defecto), espectral, autocorrelacion, cepstral
+//                 o envolvente (picos de la envolvente de Hilbert de la banda 20-200 Hz)
+//   --series      muestra además el BPM en ventanas de 10 s que avanzan de a 1 s;
+//                 en un flujo la serie se emite mientras llegan los bloques
+//   --cepstral-check compara el BPM de los picos con el del cepstro en ventanas
+//                 de 10 s cada 5 s y marca las ventanas en las que no coinciden
+//   --hrv         muestra además SDNN, RMSSD y pNN50 en ventanas de 30 s por latido
+//                 y LF/HF (Lomb-Scargle) en ventanas de 2 min cada 30 s
+//   --rules archivo
+//                 reglas de anomalías, una por línea: "codigo metrica < umbral" con
+//                 codigo bradicardia|taquicardia|irregularidad y metrica
+//                 bpm|sdnn|rmssd|pnn50|lf_hf (reemplazan a las reglas por defecto)
+//   --no-cache    no lee ni escribe la caché de señal filtrada (archivo.wav.fcc)
+//   --cache-full-hash valida la caché con el hash de todo el WAV en lugar de la
+//                 huella rápida (tamaño, fecha y primeros/últimos 64 KiB)
+//   --write-filtered salida.wav
+//                 guarda la señal filtrada y decimada y una pista con los picos
+//                 (solo al analizar un único archivo)
+//   --from/--to   analiza solo el tramo [from, to) del audio
+//   --io-uring    en lote, lee los archivos con io_uring (Linux) en lugar de stdio
+//   --queue-depth número de lecturas simultáneas con --io-uring (16 por defecto)
 
-// Lectura de audio
-vector <double> cargar_normalizar_wav (const char* filename) {
-    
-    drwav wav;
-    string ruta = string("audios/") + filename;
+/*
+Divide [0, total) en rangos contiguos y ejecuta tarea(inicio, fin) para cada uno
+en su propio hilo. Con hilos = 0 se usan todos los núcleos. Si el total es
+pequeño se usan menos hilos para no pagar su creación. Las excepciones de
+los hilos se relanzan en el hilo que llama.
+*/
+void ejecutarEnParalelo(size_t total, unsigned int hilos, const function<void(size_t, size_t)>& tarea,
+                        size_t minimo_por_hilo = 1 << 16) {
+    if (hilos == 0) hilos = max(1u, thread::hardware_concurrency());
+    size_t max_hilos = max<size_t>(1, total / max<size_t>(1, minimo_por_hilo));
+    size_t num_hilos = min<size_t>(hilos, max_hilos);
 
-    // Excepción de error al abrir
-    if (!drwav_init_file(&wav, ruta.c_str(), NULL))
-        throw runtime_error("No se encuentra el audio WAV");
+    if (num_hilos <= 1) {
+        tarea(0, total);
+        return;
+    }
 
-    // Excepción de audio MONO
-    if (wav.channels != 1) {
-        drwav_uninit(&wav);
-        throw runtime_error("El audio solo permite de 1 canal (MONO)");
+    vector<thread> trabajadores;
+    vector<exception_ptr> errores(num_hilos);
+    size_t tam_rango = (total + num_hilos - 1) / num_hilos;
+    for (size_t h = 0; h < num_hilos; h++) {
+        size_t inicio = min(total, h * tam_rango);
+        size_t fin = min(total, inicio + tam_rango);
+        trabajadores.emplace_back([&, h, inicio, fin]() {
+            try {
+                tarea(inicio, fin);
+            } catch (...) {
+                errores[h] = current_exception();
+            }
+        });
     }
+    for (auto& trabajador : trabajadores) trabajador.join();
+    for (auto& error : errores) {
+        if (error) rethrow_exception(error);
+    }
+}
 
-    // Lectura de muestras de audios WAV
-    vector<int16_t> samples(wav.totalPCMFrameCount);
-    drwav_read_pcm_frames_s16(&wav, wav.totalPCMFrameCount, samples.data());
-    drwav_uninit(&wav);
+// Ruta de un audio: un nombre sin carpeta se busca en la carpeta de audios
+string ruta_audio (const char* filename) {
+    string nombre = filename;
+    if (nombre.find('/') != string::npos || nombre.find('\\') != string::npos)
+        return nombre;
+    return string("audios/") + filename;
+}
 
-    // Normalización
-    vector <double> normalizado;
-    normalizado.reserve(samples.size());
+// Tipo en el que se decodifican las muestras antes de normalizarlas a double
+enum class FormatoMuestras { S16, S32, F32, F64 };
 
-    for (int16_t s : samples)
-        normalizado.push_back(s / 32768.0);
-    
-    return normalizado;
+/*
+Elige la ruta de decodificación que conserva toda la precisión del archivo:
+PCM de 24/32 bits se lee como int32, los flotantes de 32 bits con _f32 y los de
+64 bits se copian tal cual a double. PCM de 8/16 bits, A-law, mu-law y ADPCM no
+tienen más de 16 bits útiles, así que van por _s16.
+*/
+FormatoMuestras formatoDecodificacion(const drwav& wav) {
+    if (wav.translatedFormatTag == DR_WAVE_FORMAT_IEEE_FLOAT)
+        return wav.bitsPerSample == 64 ? FormatoMuestras::F64 : FormatoMuestras::F32;
+    if (wav.translatedFormatTag == DR_WAVE_FORMAT_PCM && wav.bitsPerSample > 16)
+        return FormatoMuestras::S32;
+    return FormatoMuestras::S16;
 }
 
+// Normalización a [-1, 1). Bucles simples para que el compilador los vectorice
+void normalizar(const int16_t* origen, size_t n, double* destino) {
+    for (size_t i = 0; i < n; ++i)
+        destino[i] = origen[i] * (1.0 / 32768.0);
+}
 
-// FFT
-vector<complex<double>> fft(const vector<complex<double>>& x) {
-    size_t N = x.size();
-    if (N <= 1) return x;
-    
-    // Verificar que N sea potencia de 2
-    if ((N & (N - 1)) != 0) {
-        throw runtime_error("FFT requiere que el tamaño sea potencia de 2");
-    }
-
-    // Separar muestras pares e impares
-    vector<complex<double>> even(N / 2), odd(N / 2);
-    for (size_t i = 0; i < N / 2; ++i) {
-        even[i] = x[2 * i];
-        odd[i]  = x[2 * i + 1];
-    }
+void normalizar(const int32_t* origen, size_t n, double* destino) {
+    for (size_t i = 0; i < n; ++i)
+        destino[i] = origen[i] * (1.0 / 2147483648.0);
+}
 
-    // FFT recursiva de pares e impares
-    vector<complex<double>> Fe = fft(even);
-    vector<complex<double>> Fo = fft(odd);
+void normalizar(const float* origen, size_t n, double* destino) {
+    for (size_t i = 0; i < n; ++i)
+        destino[i] = origen[i];
+}
 
-    // Combinar resultados
-    vector<complex<double>> F(N);
+void normalizar(const double* origen, size_t n, double* destino) {
+    copy(origen, origen + n, destino);
+}
 
-    for (size_t k = 0; k < N / 2; ++k) {
-        complex<double> wk = polar(1.0, -2.0 * PI * k / static_cast<double>(N));
-        complex<double> t  = wk * Fo[k];
+// Buffers temporales de decodificación; solo se usa el del formato elegido
+struct BufferDecodificacion {
+    vector<int16_t> s16;
+    vector<int32_t> s32;
+    vector<float> f32;
+};
 
-        F[k]         = Fe[k] + t;
-        F[k + N / 2] = Fe[k] - t;
+/*
+Decodifica hasta n cuadros en el formato indicado y los normaliza en la misma pasada.
+destino recibe n * canales muestras entrelazadas; devuelve los cuadros leídos.
+*/
+size_t leerNormalizado(drwav& wav, FormatoMuestras formato, BufferDecodificacion& temporal, size_t n, double* destino) {
+    size_t canales = wav.channels;
+    size_t leidos = 0;
+    switch (formato) {
+        case FormatoMuestras::S32:
+            temporal.s32.resize(n * canales);
+            leidos = drwav_read_pcm_frames_s32(&wav, n, temporal.s32.data());
+            normalizar(temporal.s32.data(), leidos * canales, destino);
+            break;
+        case FormatoMuestras::F64:
+            // drwav_read_pcm_frames entrega las muestras crudas en el orden de bytes del equipo
+            leidos = drwav_read_pcm_frames(&wav, n, destino);
+            break;
+        case FormatoMuestras::F32:
+            temporal.f32.resize(n * canales);
+            leidos = drwav_read_pcm_frames_f32(&wav, n, temporal.f32.data());
+            normalizar(temporal.f32.data(), leidos * canales, destino);
+            break;
+        default:
+            temporal.s16.resize(n * canales);
+            leidos = drwav_read_pcm_frames_s16(&wav, n, temporal.s16.data());
+            normalizar(temporal.s16.data(), leidos * canales, destino);
+            break;
     }
-
-    return F;
+    return leidos;
 }
 
-vector<complex<double>> fft_real(const vector<double>& x) {
-    vector<complex<double>> xc(x.size());
-    for (size_t i = 0; i < x.size(); ++i) {
-        xc[i] = complex<double>(x[i], 0.0);   // parte imaginaria = 0
+// Separa cuadros entrelazados en un buffer por canal (planar)
+void desentrelazar(const double* entrelazado, size_t cuadros, size_t canales, double* const* planos) {
+    if (canales == 2) {
+        // Caso estéreo sin bucle interno para que el compilador lo vectorice
+        double* izquierdo = planos[0];
+        double* derecho = planos[1];
+        for (size_t i = 0; i < cuadros; ++i) {
+            izquierdo[i] = entrelazado[2 * i];
+            derecho[i]   = entrelazado[2 * i + 1];
+        }
+        return;
+    }
+    for (size_t c = 0; c < canales; ++c) {
+        double* plano = planos[c];
+        for (size_t i = 0; i < cuadros; ++i)
+            plano[i] = entrelazado[i * canales + c];
     }
-    return fft(xc);
 }
 
-// Calcula la siguiente potencia de 2 mayor o igual a n (para zero-padding)
-size_t siguiente_potencia2(size_t n) {
-    size_t p = 1;
-    while (p < n) p <<= 1;
-    return p;
+// Mezcla cuadros entrelazados a un solo canal promediando los canales
+void mezclarCanales(const double* entrelazado, size_t cuadros, size_t canales, double* destino) {
+    double escala = 1.0 / canales;
+    for (size_t i = 0; i < cuadros; ++i) {
+        double suma = 0.0;
+        for (size_t c = 0; c < canales; ++c)
+            suma += entrelazado[i * canales + c];
+        destino[i] = suma * escala;
+    }
 }
 
-// Recibe la señal normalizada en el tiempo y devuelve el espectro listo para filtrar
-vector<complex<double>> obtenerEspectroParaFiltrado(const vector<double>& senalTiempo) {
-    // Copiar y rellenar con ceros hasta la siguiente potencia de 2
-    vector<double> senal = senalTiempo;
-    size_t N_fft = siguiente_potencia2(senal.size());
-    senal.resize(N_fft, 0.0);
+// Archivo WAV completo ya cargado en memoria
+struct BytesEnMemoria {
+    const void* datos;
+    size_t tamano;
+};
 
-    // Aplicar FFT
-    vector<complex<double>> espectro = fft_real(senal);
-    return espectro;
-}
+// Formato de un flujo PCM sin cabecera (muestras little-endian entrelazadas)
+struct FormatoPCMCrudo {
+    unsigned int frecuencia_muestreo = 0;
+    unsigned int canales = 1;
+    FormatoMuestras tipo = FormatoMuestras::S16;   // S16, S32 o F32
+};
 
+/*
+Lector de WAV por bloques: cada llamada a siguienteBloque decodifica como máximo
+tam_bloque cuadros y los devuelve normalizados, así que la memoria usada es
+proporcional al bloque y no a la duración del audio. Un audio multicanal se
+puede leer mezclado a un canal o con un buffer por canal.
+Además de archivos y memoria, puede leer un flujo secuencial (entrada estándar,
+FIFO, tubería), con cabecera WAV o como PCM crudo; en ese caso la longitud no
+se conoce de antemano y solo se puede avanzar.
+*/
+class WavStream {
+public:
+    explicit WavStream(const string& ruta, size_t tam_bloque = 4096) : tam_bloque_(tam_bloque) {
+        validarBloque();
 
-// Filtrado de frecuencias cardiacas
-void filtrarFrecuencias(vector<complex<double>>& fft, double fs) { // fs = frecuencia de muestreo
-    int n = fft.size();
-    double minFreq = 0.5;
-    double maxFreq = 3.5;
+        // Excepción de error al abrir
+        if (!drwav_init_file(&wav_, ruta.c_str(), NULL))
+            throw runtime_error("No se encuentra el audio WAV");
 
-    for (int i = 0; i <= n/2; i++) {
-        double freq = (i * fs) / n;
+        iniciarDesdeWav(true);
+    }
 
-        if (freq < minFreq || freq > maxFreq) {
-            fft[i] = {0.0, 0.0};
+    // Lee desde un WAV en memoria, que debe seguir vivo mientras se use el flujo
+    explicit WavStream(const BytesEnMemoria& memoria, size_t tam_bloque = 4096) : tam_bloque_(tam_bloque) {
+        validarBloque();
 
-            if (i != 0 && i != n/2)
-                fft[n - i] = {0.0, 0.0};
-        }
+        if (!drwav_init_memory(&wav_, memoria.datos, memoria.tamano, NULL))
+            throw runtime_error("El contenido no es un audio WAV válido");
+
+        iniciarDesdeWav(true);
     }
-}
 
+    // Lee un WAV desde un flujo secuencial; dr_wav lo recorre con callbacks sin retroceder
+    explicit WavStream(FILE* entrada, size_t tam_bloque = 4096) : tam_bloque_(tam_bloque) {
+        validarBloque();
+        entrada_.archivo = entrada;
 
-// IFFT
-vector<complex<double>> ifft(const vector<complex<double>>& X) 
-{
-    size_t N = X.size();
-    if (N <= 1) return X; 
-    //Verificar que N sea potencia de 2
-    // usen try-catch para probar 
-    if ((N & (N - 1)) != 0)
-    {
-        throw runtime_error("IFFT requiere que el tamaño sea potencia de 2");
+        if (!drwav_init_ex(&wav_, leerEntrada, saltarEntrada, posicionEntrada, NULL, &entrada_, NULL,
+                           DRWAV_SEQUENTIAL, NULL))
+            throw runtime_error("El flujo no contiene un audio WAV válido");
+
+        iniciarDesdeWav(false);
     }
-    // Conjugar las muestras de entrada
-    vector<complex<double>> X_conj(N);
-    for (size_t i = 0; i < N; ++i) 
-    {
-        X_conj[i] = conj(X[i]);
+
+    // Lee PCM sin cabecera desde un flujo secuencial, con el formato indicado
+    WavStream(FILE* entrada, const FormatoPCMCrudo& formato, size_t tam_bloque = 4096) : tam_bloque_(tam_bloque) {
+        validarBloque();
+        if (formato.frecuencia_muestreo == 0 || formato.canales == 0)
+            throw runtime_error("El formato PCM crudo necesita frecuencia de muestreo y canales");
+        if (formato.tipo == FormatoMuestras::F64)
+            throw runtime_error("Formato de muestra no soportado para PCM crudo");
+
+        entrada_.archivo = entrada;
+        crudo_ = formato;
+        es_crudo_ = true;
+        formato_ = formato.tipo;
     }
-    //fft a las muestras
-    vector<complex<double>> x_conj = fft(X_conj);
-    // Conjugar el resultado y dividir por N
-    vector<complex<double>> x(N);
-    for (size_t i = 0; i < N; ++i) 
-    {
-        x[i] = conj(x_conj[i]) / static_cast<double>(N);
+
+    ~WavStream() {
+        if (!es_crudo_) drwav_uninit(&wav_);
     }
-    return x;
-}
-/*
-Para extraer la parte real despues de de la ifft
-*/
-vector<double> ifft_real(const vector<complex<double>>& X) {
-    vector<complex<double>> resultado = ifft(X);
-    vector<double> real(resultado.size());
-    for (size_t i = 0; i < resultado.size(); ++i) 
-    {
-        real[i] = resultado[i].real();
+
+    WavStream(const WavStream&) = delete;
+    WavStream& operator=(const WavStream&) = delete;
+
+    // Bloque de un canal; si el audio es multicanal se mezcla. Devuelve false al terminar
+    bool siguienteBloque(vector<double>& bloque) {
+        size_t num_canales = canales();
+        if (num_canales == 1) {
+            bloque.resize(tam_bloque_);
+            size_t leidos = leerCuadros(tam_bloque_, bloque.data());
+            bloque.resize(leidos);
+            return leidos > 0;
+        }
+
+        entrelazado_.resize(tam_bloque_ * num_canales);
+        size_t leidos = leerCuadros(tam_bloque_, entrelazado_.data());
+        bloque.resize(leidos);
+        mezclarCanales(entrelazado_.data(), leidos, num_canales, bloque.data());
+        return leidos > 0;
     }
-    return real;
-}
 
+    // Bloque con un buffer por canal, de como máximo max_cuadros cuadros. Devuelve false al terminar
+    bool siguienteBloque(vector<vector<double>>& planos, size_t max_cuadros = numeric_limits<size_t>::max()) {
+        size_t num_canales = canales();
+        size_t n = min(tam_bloque_, max_cuadros);
+        entrelazado_.resize(n * num_canales);
+        size_t leidos = leerCuadros(n, entrelazado_.data());
 
-// Extracción de BPM
-vector<size_t> detectarPicos(const vector<double>& senal_filtrada, double umbral_picos, int distancia_minima_muestras) {
-    vector<size_t> indices_picos;
-    if (senal_filtrada.empty()) {
-        return indices_picos;
+        planos.resize(num_canales);
+        vector<double*> destinos(num_canales);
+        for (size_t c = 0; c < num_canales; ++c) {
+            planos[c].resize(leidos);
+            destinos[c] = planos[c].data();
+        }
+        desentrelazar(entrelazado_.data(), leidos, num_canales, destinos.data());
+        return leidos > 0;
     }
 
-    double valor_maximo = *std::max_element(senal_filtrada.begin(), senal_filtrada.end());
-    double umbral_absoluto = valor_maximo * umbral_picos; 
+    // Posiciona la lectura en un cuadro. En flujos secuenciales solo se puede avanzar
+    bool saltarACuadro(drwav_uint64 cuadro) {
+        if (longitud_conocida_) {
+            if (drwav_seek_to_pcm_frame(&wav_, cuadro) != DRWAV_TRUE) return false;
+            cursor_ = cuadro;
+            return true;
+        }
 
-    for (size_t i = 1; i < senal_filtrada.size() - 1; ++i) {
-        if (senal_filtrada[i] > umbral_absoluto && 
-            senal_filtrada[i] > senal_filtrada[i-1] && 
-            senal_filtrada[i] > senal_filtrada[i+1]) {
-            
-            bool es_pico_valido = true;
-            if (!indices_picos.empty()) {
-                if (i - indices_picos.back() < static_cast<size_t>(distancia_minima_muestras)) {
-                    es_pico_valido = false;
-                }
-            }
-            if (es_pico_valido) {
-                indices_picos.push_back(i);
-            }
+        if (cuadro < cursor_) return false;
+        while (cursor_ < cuadro) {
+            size_t n = static_cast<size_t>(min<drwav_uint64>(tam_bloque_, cuadro - cursor_));
+            entrelazado_.resize(n * canales());
+            if (leerCuadros(n, entrelazado_.data()) == 0) break;   // el flujo terminó antes
         }
+        return true;
     }
-    return indices_picos;
-}
 
-// Estructura para almacenar los resultados del BPM
-struct ResultadosBPM {
-    double bpm_promedio;
-    vector<double> intervalos_rr_segundos; 
-    vector<size_t> indices_picos;
-};
+    unsigned int frecuenciaMuestreo() const { return es_crudo_ ? crudo_.frecuencia_muestreo : wav_.sampleRate; }
+    unsigned int canales() const { return es_crudo_ ? crudo_.canales : wav_.channels; }
 
-ResultadosBPM extraerBPM(const vector<double>& senal_filtrada, double frecuencia_muestreo, double umbral_picos = 0.7, int distancia_minima_muestras = 0) {
-    ResultadosBPM resultados;
-    resultados.bpm_promedio = 0.0;
-    resultados.intervalos_rr_segundos.clear();
-    resultados.indices_picos.clear();
+    unsigned int bitsPorMuestra() const {
+        if (!es_crudo_) return wav_.bitsPerSample;
+        return crudo_.tipo == FormatoMuestras::S16 ? 16 : 32;
+    }
 
-    if (senal_filtrada.empty() || frecuencia_muestreo <= 0) {
-        return resultados;
+    // En flujos secuenciales la longitud solo se conoce al llegar al final
+    bool longitudConocida() const { return longitud_conocida_; }
+    drwav_uint64 totalCuadros() const { return longitud_conocida_ ? wav_.totalPCMFrameCount : numeric_limits<drwav_uint64>::max(); }
+
+    size_t tamBloque() const { return tam_bloque_; }
+
+private:
+    // Flujo secuencial y bytes consumidos de él (dr_wav necesita conocer la posición)
+    struct EntradaSecuencial {
+        FILE* archivo = nullptr;
+        drwav_int64 posicion = 0;
+    };
+
+    static size_t leerEntrada(void* usuario, void* destino, size_t bytes) {
+        EntradaSecuencial* entrada = static_cast<EntradaSecuencial*>(usuario);
+        size_t leidos = fread(destino, 1, bytes, entrada->archivo);
+        entrada->posicion += leidos;
+        return leidos;
     }
-    // Calcular una distancia mínima
-    if (distancia_minima_muestras == 0) {
-        distancia_minima_muestras = static_cast<int>(0.2 * frecuencia_muestreo); // 0.2 segundos de "refractario" entre picos
-        if (distancia_minima_muestras < 1) distancia_minima_muestras = 1;
+
+    // Solo permite avanzar: los saltos hacia delante se resuelven leyendo y descartando
+    static drwav_bool32 saltarEntrada(void* usuario, int desplazamiento, drwav_seek_origin origen) {
+        EntradaSecuencial* entrada = static_cast<EntradaSecuencial*>(usuario);
+        if (origen == DRWAV_SEEK_END) return DRWAV_FALSE;
+        drwav_int64 destino = (origen == DRWAV_SEEK_SET) ? desplazamiento : entrada->posicion + desplazamiento;
+        if (destino < entrada->posicion) return DRWAV_FALSE;
+
+        char descarte[4096];
+        while (entrada->posicion < destino) {
+            size_t n = static_cast<size_t>(min<drwav_int64>(sizeof(descarte), destino - entrada->posicion));
+            if (leerEntrada(usuario, descarte, n) != n) return DRWAV_FALSE;
+        }
+        return DRWAV_TRUE;
     }
 
-    resultados.indices_picos = detectarPicos(senal_filtrada, umbral_picos, distancia_minima_muestras);
+    static drwav_bool32 posicionEntrada(void* usuario, drwav_int64* posicion) {
+        *posicion = static_cast<EntradaSecuencial*>(usuario)->posicion;
+        return DRWAV_TRUE;
+    }
 
-    if (resultados.indices_picos.size() < 2) {
-        return resultados; // Minimo dos picos para calcular un intervalo
+    void validarBloque() {
+        if (tam_bloque_ == 0)
+            throw runtime_error("El tamaño de bloque debe ser mayor que 0");
     }
 
-    // Calcular los intervalos RR 
-    for (size_t i = 0; i < resultados.indices_picos.size() - 1; ++i) {
-        double tiempo_entre_picos = (double)(resultados.indices_picos[i+1] - resultados.indices_picos[i]) / frecuencia_muestreo;
-        resultados.intervalos_rr_segundos.push_back(tiempo_entre_picos);
+    void iniciarDesdeWav(bool longitud_conocida) {
+        formato_ = formatoDecodificacion(wav_);
+        longitud_conocida_ = longitud_conocida;
     }
 
-    // Calcular BPM promedio
-    if (!resultados.intervalos_rr_segundos.empty()) {
-        double suma_intervalos = std::accumulate(resultados.intervalos_rr_segundos.begin(), resultados.intervalos_rr_segundos.end(), 0.0);
-        double promedio_intervalo_rr = suma_intervalos / resultados.intervalos_rr_segundos.size();
+    // Lee hasta n cuadros entrelazados y normalizados; devuelve los cuadros leídos
+    size_t leerCuadros(size_t n, double* destino) {
+        size_t leidos = es_crudo_ ? leerCrudo(n, destino) : leerNormalizado(wav_, formato_, temporal_, n, destino);
+        cursor_ += leidos;
+        return leidos;
+    }
 
-        if (promedio_intervalo_rr > 0) {
-            resultados.bpm_promedio = 60.0 / promedio_intervalo_rr;
+    size_t leerCrudo(size_t n, double* destino) {
+        size_t muestras = n * crudo_.canales;
+        size_t leidas = 0;
+        switch (crudo_.tipo) {
+            case FormatoMuestras::S32:
+                temporal_.s32.resize(muestras);
+                leidas = leerMuestrasCompletas(temporal_.s32.data(), muestras);
+                normalizar(temporal_.s32.data(), leidas, destino);
+                break;
+            case FormatoMuestras::F32:
+                temporal_.f32.resize(muestras);
+                leidas = leerMuestrasCompletas(temporal_.f32.data(), muestras);
+                normalizar(temporal_.f32.data(), leidas, destino);
+                break;
+            default:
+                temporal_.s16.resize(muestras);
+                leidas = leerMuestrasCompletas(temporal_.s16.data(), muestras);
+                normalizar(temporal_.s16.data(), leidas, destino);
+                break;
         }
+        return leidas / crudo_.canales;
     }
-    
-    return resultados;
+
+    // Lee muestras hasta completar el pedido o llegar al final (las tuberías entregan lecturas parciales)
+    template <typename T>
+    size_t leerMuestrasCompletas(T* destino, size_t muestras) {
+        size_t bytes = leerEntrada(&entrada_, destino, muestras * sizeof(T));
+        size_t completas = bytes / sizeof(T);
+        return completas - completas % crudo_.canales;   // se descartan cuadros incompletos al final
+    }
+
+    drwav wav_;
+    size_t tam_bloque_;
+    FormatoMuestras formato_ = FormatoMuestras::S16;
+    BufferDecodificacion temporal_;
+    vector<double> entrelazado_;
+    EntradaSecuencial entrada_;   // dr_wav guarda un puntero a este miembro
+    FormatoPCMCrudo crudo_;
+    bool es_crudo_ = false;
+    bool longitud_conocida_ = false;
+    drwav_uint64 cursor_ = 0;
+};
+
+// Lectura de audio (un audio multicanal se mezcla a un solo canal)
+vector <double> cargar_normalizar_wav (const char* filename) {
+
+    WavStream flujo(ruta_audio(filename));
+
+    vector <double> normalizado;
+    normalizado.reserve(flujo.totalCuadros());
+
+    // Lectura por bloques: no se guarda una copia completa en el formato original
+    vector <double> bloque;
+    while (flujo.siguienteBloque(bloque))
+        normalizado.insert(normalizado.end(), bloque.begin(), bloque.end());
+
+    return normalizado;
 }
 
-// Detección de anomalias
-struct Anomalias
-{
-    bool bradicardia = false;
-    bool taquicardia = false;
-    bool irregularidad = false;
-    vector<string> lista_alertas;
+// Intervalo de tiempo [inicio, fin) en segundos
+struct RangoTiempo {
+    double inicio;
+    double fin;
 };
 
-Anomalias detectarAnomalias(const ResultadosBPM &datos)
-{
-    Anomalias a;
+// Audio decodificado (completo o un tramo), con un vector por canal y los datos de su formato
+struct Grabacion {
+    vector<vector<double>> canales;
+    double frecuencia_muestreo = 0.0;
+    unsigned int num_canales = 0;
+    unsigned int bits_por_muestra = 0;
+    double duracion_segundos = 0.0;   // duración de las muestras cargadas
+    size_t cuadro_inicio = 0;         // posición del primer cuadro dentro del archivo
+};
 
-    if (datos.bpm_promedio == 0 || datos.intervalos_rr_segundos.empty())
-    {
-        a.lista_alertas.push_back("No se puede evaluar anomalías (datos insuficientes)");
-        return a;
-    }
+// Copia los datos de formato del WAV a la grabación
+void describirGrabacion(const drwav& wav, Grabacion& grabacion) {
+    grabacion.frecuencia_muestreo = wav.sampleRate;
+    grabacion.num_canales = wav.channels;
+    grabacion.bits_por_muestra = wav.bitsPerSample;
+    grabacion.duracion_segundos = wav.sampleRate > 0 ? static_cast<double>(wav.totalPCMFrameCount) / wav.sampleRate : 0.0;
+}
+
+// Igual, a partir de un flujo; si la longitud no se conoce la duración queda en 0
+void describirGrabacion(const WavStream& flujo, Grabacion& grabacion) {
+    grabacion.frecuencia_muestreo = flujo.frecuenciaMuestreo();
+    grabacion.num_canales = flujo.canales();
+    grabacion.bits_por_muestra = flujo.bitsPorMuestra();
+    grabacion.duracion_segundos = flujo.longitudConocida() && flujo.frecuenciaMuestreo() > 0 ?
+        static_cast<double>(flujo.totalCuadros()) / flujo.frecuenciaMuestreo() : 0.0;
+}
 
-    double bpm = datos.bpm_promedio;
+/*
+Decodifica solo los cuadros del rango pedido, saltando directamente a su inicio.
+Los vectores de 'segmento' se vacían pero conservan su memoria, así que un mismo
+segmento se puede reutilizar entre lecturas. Si se pasa 'al_leer_bloque', se le
+entrega cada bloque (un vector por canal) en cuanto se decodifica, lo que permite
+procesar un flujo a medida que llega.
+*/
+void leerSegmento(WavStream& flujo, const RangoTiempo& rango, Grabacion& segmento,
+                  const function<void(const vector<vector<double>>&)>& al_leer_bloque = nullptr) {
+    if (rango.inicio < 0 || !(rango.fin > rango.inicio))
+        throw runtime_error("Rango de tiempo inválido");
 
-    // --- Reglas simples ---
-    if (bpm < 60)
-    {
-        a.bradicardia = true;
-        a.lista_alertas.push_back("Bradicardia detectada (BPM < 60)");
+    // Con longitud desconocida (flujos) se lee hasta el final del rango o del flujo
+    double fs = flujo.frecuenciaMuestreo();
+    double total = flujo.longitudConocida() ? static_cast<double>(flujo.totalCuadros()) : numeric_limits<double>::infinity();
+    double primero_real = min(total, floor(rango.inicio * fs));
+    double ultimo_real = min(total, ceil(rango.fin * fs));
+    size_t primero = static_cast<size_t>(primero_real);
+    size_t ultimo = isinf(ultimo_real) ? numeric_limits<size_t>::max() : static_cast<size_t>(ultimo_real);
+
+    describirGrabacion(flujo, segmento);
+    segmento.cuadro_inicio = primero;
+    segmento.canales.resize(flujo.canales());
+    for (auto& canal : segmento.canales) {
+        canal.clear();
+        if (flujo.longitudConocida()) canal.reserve(ultimo > primero ? ultimo - primero : 0);
     }
-    if (bpm > 100)
-    {
-        a.taquicardia = true;
-        a.lista_alertas.push_back("Taquicardia detectada (BPM > 100)");
+    if (primero >= ultimo) {
+        segmento.duracion_segundos = 0.0;
+        return;
     }
 
-    // --- Irregularidad usando variabilidad RR ---
-    double promedio = accumulate(datos.intervalos_rr_segundos.begin(),
-                                 datos.intervalos_rr_segundos.end(), 0.0) /
-                      datos.intervalos_rr_segundos.size();
+    if (!flujo.saltarACuadro(primero))
+        throw runtime_error("No se puede posicionar en el audio WAV");
 
-    double varianza = 0.0;
-    for (double rr : datos.intervalos_rr_segundos)
-    {
-        varianza += pow(rr - promedio, 2);
+    vector<vector<double>> bloque;
+    size_t restantes = ultimo - primero;
+    while (restantes > 0 && flujo.siguienteBloque(bloque, restantes)) {
+        for (size_t c = 0; c < segmento.canales.size(); c++)
+            segmento.canales[c].insert(segmento.canales[c].end(), bloque[c].begin(), bloque[c].end());
+        if (al_leer_bloque) al_leer_bloque(bloque);
+        restantes -= bloque[0].size();
     }
-    varianza /= datos.intervalos_rr_segundos.size();
-    double sdnn = sqrt(varianza); // desviación estándar RR
+    segmento.duracion_segundos = segmento.canales[0].size() / fs;
+}
 
-    // Regla simple para irregularidad cardíaca
-    if (sdnn > 0.10)
-    { // >100 ms
-        a.irregularidad = true;
-        a.lista_alertas.push_back("Latido irregular (SDNN > 0.10s)");
+Grabacion leerSegmento(WavStream& flujo, const RangoTiempo& rango) {
+    Grabacion segmento;
+    leerSegmento(flujo, rango, segmento);
+    return segmento;
+}
+
+// Lectura de varios tramos de un mismo audio
+vector <Grabacion> cargar_segmentos_wav (const char* filename, const vector<RangoTiempo>& rangos) {
+    WavStream flujo(ruta_audio(filename));
+    vector <Grabacion> segmentos;
+    for (const auto& rango : rangos)
+        segmentos.push_back(leerSegmento(flujo, rango));
+    return segmentos;
+}
+
+// Lectura del tramo [t_inicio, t_fin) segundos de un audio
+Grabacion cargar_segmento_wav (const char* filename, double t_inicio, double t_fin) {
+    return cargar_segmentos_wav(filename, {{t_inicio, t_fin}})[0];
+}
+
+// Lectura de un audio completo con sus datos de formato
+Grabacion cargar_grabacion (const char* filename) {
+    return cargar_segmento_wav(filename, 0.0, numeric_limits<double>::infinity());
+}
+
+// Cola sin bloqueos de capacidad fija para un productor y un consumidor
+template <typename T, size_t Capacidad>
+class ColaSPSC {
+public:
+    // Devuelve false si la cola está llena
+    bool encolar(const T& valor) {
+        size_t cola = cola_.load(memory_order_relaxed);
+        if (cola - cabeza_.load(memory_order_acquire) == Capacidad) return false;
+        datos_[cola % Capacidad] = valor;
+        cola_.store(cola + 1, memory_order_release);
+        return true;
     }
 
-    if (a.lista_alertas.empty())
-    {
-        a.lista_alertas.push_back("No se detectaron anomalías.");
+    // Devuelve false si la cola está vacía
+    bool desencolar(T& valor) {
+        size_t cabeza = cabeza_.load(memory_order_relaxed);
+        if (cabeza == cola_.load(memory_order_acquire)) return false;
+        valor = datos_[cabeza % Capacidad];
+        cabeza_.store(cabeza + 1, memory_order_release);
+        return true;
     }
 
-    return a;
-}
+private:
+    array<T, Capacidad> datos_;
+    alignas(64) atomic<size_t> cabeza_{0};   // siguiente posición a leer (consumidor)
+    alignas(64) atomic<size_t> cola_{0};     // siguiente posición a escribir (productor)
+};
 
-// ========== PRUEBAS UNITARIAS ==========
-void pruebasUnitarias() {
-    cout << "\n========== PRUEBAS UNITARIAS ==========\n" << endl;
-    int pruebas_exitosas = 0;
-    int pruebas_totales = 0;
+// Semáforo contador (std::counting_semaphore es de C++20)
+class Semaforo {
+public:
+    explicit Semaforo(size_t inicial = 0) : cuenta_(inicial) {}
 
-    // Prueba 1: FFT de señal simple
-    pruebas_totales++;
-    try {
-        vector<double> senal = {1.0, 0.0, -1.0, 0.0};
-        vector<complex<double>> resultado = fft_real(senal);
-        if (resultado.size() == 4) {
-            cout << "[OK] Prueba 1: FFT procesa señal correctamente" << endl;
-            pruebas_exitosas++;
-        } else {
-            cout << "[FAIL] Prueba 1: Tamaño incorrecto" << endl;
+    void liberar() {
+        {
+            lock_guard<mutex> bloqueo(mutex_);
+            cuenta_++;
         }
-    } catch (...) {
-        cout << "[FAIL] Prueba 1: Excepción inesperada" << endl;
+        condicion_.notify_one();
     }
 
-    // Prueba 2: FFT requiere potencia de 2
-    pruebas_totales++;
-    try {
-        vector<complex<double>> senal_invalida = {{1,0}, {2,0}, {3,0}};
-        fft(senal_invalida);
-        cout << "[FAIL] Prueba 2: No detectó tamaño inválido" << endl;
-    } catch (runtime_error& e) {
-        cout << "[OK] Prueba 2: FFT rechaza tamaño no potencia de 2" << endl;
-        pruebas_exitosas++;
+    void adquirir() {
+        unique_lock<mutex> bloqueo(mutex_);
+        condicion_.wait(bloqueo, [this] { return cuenta_ > 0; });
+        cuenta_--;
     }
 
-    // Prueba 3: IFFT recupera señal original
-    pruebas_totales++;
-    try {
-        vector<double> original = {1.0, 2.0, 3.0, 4.0};
-        vector<complex<double>> fft_result = fft_real(original);
-        vector<double> recuperada = ifft_real(fft_result);
-        bool correcto = true;
-        for (size_t i = 0; i < original.size(); i++) {
-            if (abs(original[i] - recuperada[i]) > 0.001) {
-                correcto = false;
+private:
+    mutex mutex_;
+    condition_variable condicion_;
+    size_t cuenta_;
+};
+
+/*
+ColaSPSC con espera bloqueante: un semáforo cuenta los elementos y otro los
+huecos, así que el hilo que encuentra la cola vacía (o llena) se duerme en lugar
+de girar, y deja el núcleo libre para la FFT y la detección en paralelo.
+*/
+template <typename T, size_t Capacidad>
+class ColaSPSCBloqueante {
+public:
+    void encolar(const T& valor) {
+        huecos_.adquirir();
+        cola_.encolar(valor);
+        elementos_.liberar();
+    }
+
+    T desencolar() {
+        elementos_.adquirir();
+        T valor{};   // el semáforo garantiza que hay un elemento
+        cola_.desencolar(valor);
+        huecos_.liberar();
+        return valor;
+    }
+
+private:
+    ColaSPSC<T, Capacidad> cola_;
+    Semaforo elementos_{0};
+    Semaforo huecos_{Capacidad};
+};
+
+// Grabación de un lote cargada en uno de los buffers reutilizables
+struct BufferGrabacion {
+    size_t indice = 0;       // posición del archivo dentro del lote
+    Grabacion audio;
+    string error;            // vacío si la carga fue correcta
+};
+
+/*
+Procesa un lote de audios con precarga: un hilo de E/S lee y decodifica el
+archivo k+1 mientras el hilo que llama procesa el archivo k. Los dos hilos
+intercambian un par de buffers reutilizables por colas SPSC bloqueantes, así que
+la lectura queda oculta detrás del procesamiento, no se reserva memoria por
+archivo y el hilo que espera no ocupa un núcleo.
+*/
+void procesarLote(const vector<string>& rutas, const RangoTiempo& rango,
+                  const function<void(const string&, const BufferGrabacion&)>& procesar) {
+    const size_t NUM_BUFFERS = 2;
+    array<BufferGrabacion, NUM_BUFFERS> buffers;
+    ColaSPSCBloqueante<BufferGrabacion*, NUM_BUFFERS> libres, llenos;
+    for (auto& buffer : buffers) libres.encolar(&buffer);
+
+    thread lector([&]() {
+        for (size_t k = 0; k < rutas.size(); k++) {
+            BufferGrabacion* buffer = libres.desencolar();
+
+            buffer->indice = k;
+            buffer->error.clear();
+            try {
+                WavStream flujo(rutas[k]);
+                leerSegmento(flujo, rango, buffer->audio);
+            } catch (exception& e) {
+                buffer->error = e.what();
+            }
+
+            llenos.encolar(buffer);
+        }
+    });
+
+    exception_ptr error_procesamiento;
+    for (size_t k = 0; k < rutas.size(); k++) {
+        BufferGrabacion* buffer = llenos.desencolar();
+
+        // Tras un error se siguen devolviendo buffers para que el lector termine
+        if (!error_procesamiento) {
+            try {
+                procesar(rutas[k], *buffer);
+            } catch (...) {
+                error_procesamiento = current_exception();
+            }
+        }
+
+        libres.encolar(buffer);
+    }
+    lector.join();
+    if (error_procesamiento) rethrow_exception(error_procesamiento);
+}
+
+// Recibe un archivo leído por completo (o el error al leerlo) y su posición en el lote
+using ReceptorArchivo = function<void(size_t, const vector<uint8_t>&, const string&)>;
+
+// Archivo de un lote leído en su propio buffer, del tamaño que da fstat
+struct ArchivoLeido {
+    size_t indice = 0;
+    vector<uint8_t> datos;
+    string error;
+};
+
+/*
+Lector de lotes de archivos con io_uring: mantiene hasta 'profundidad' archivos
+en lectura a la vez. Cada archivo tiene su propio buffer del tamaño que da fstat
+y el kernel lee directamente en él (IORING_OP_READ en el desplazamiento
+pendiente, a lo sumo tam_bloque bytes por petición), sin copias intermedias.
+Los archivos terminados pasan por una ColaSPSCBloqueante a un hilo trabajador
+que llama al receptor (en orden de finalización, de a uno), de modo que el
+anillo sigue con lecturas en vuelo mientras se decodifica y analiza.
+Si io_uring no está disponible (otro sistema, kernel antiguo o sin permisos) se
+lee cada archivo con stdio, uno tras otro, con el mismo trabajador.
+*/
+class LectorLoteUring {
+public:
+    explicit LectorLoteUring(unsigned int profundidad = 16, size_t tam_bloque = 1 << 20)
+        : profundidad_(max(1u, profundidad)), tam_bloque_(max<size_t>(1, tam_bloque)) {
+#ifdef USAR_IO_URING
+        iniciarAnillo();
+#endif
+    }
+
+    ~LectorLoteUring() {
+#ifdef USAR_IO_URING
+        if (anillo_fd_ >= 0) {
+            munmap(sqes_, num_sqes_ * sizeof(io_uring_sqe));
+            if (cq_ptr_ != sq_ptr_) munmap(cq_ptr_, cq_tamano_);
+            munmap(sq_ptr_, sq_tamano_);
+            close(anillo_fd_);
+        }
+#endif
+    }
+
+    LectorLoteUring(const LectorLoteUring&) = delete;
+    LectorLoteUring& operator=(const LectorLoteUring&) = delete;
+
+    bool usaIoUring() const { return anillo_fd_ >= 0; }
+
+    void leer(const vector<string>& rutas, const ReceptorArchivo& recibir) {
+        // Archivos terminados a la espera del trabajador; nullptr indica el final del lote
+        const size_t EN_ESPERA = 4;
+        ColaSPSCBloqueante<ArchivoLeido*, EN_ESPERA> terminados;
+        exception_ptr error_receptor;
+        thread trabajador([&]() {
+            while (ArchivoLeido* archivo = terminados.desencolar()) {
+                // Tras un error se siguen vaciando archivos para que la lectura termine
+                if (!error_receptor) {
+                    try {
+                        recibir(archivo->indice, archivo->datos, archivo->error);
+                    } catch (...) {
+                        error_receptor = current_exception();
+                    }
+                }
+                delete archivo;
+            }
+        });
+
+        auto entregar = [&](unique_ptr<ArchivoLeido> archivo) { terminados.encolar(archivo.release()); };
+        try {
+#ifdef USAR_IO_URING
+            if (anillo_fd_ >= 0) {
+                leerConAnillo(rutas, entregar);
+            } else
+#endif
+            {
+                leerConStdio(rutas, entregar);
+            }
+        } catch (...) {
+            terminados.encolar(nullptr);
+            trabajador.join();
+            throw;
+        }
+        terminados.encolar(nullptr);
+        trabajador.join();
+        if (error_receptor) rethrow_exception(error_receptor);
+    }
+
+private:
+    using Entrega = function<void(unique_ptr<ArchivoLeido>)>;
+
+    static unique_ptr<ArchivoLeido> archivoConError(size_t indice, const string& error) {
+        unique_ptr<ArchivoLeido> archivo(new ArchivoLeido);
+        archivo->indice = indice;
+        archivo->error = error;
+        return archivo;
+    }
+
+    void leerConStdio(const vector<string>& rutas, const Entrega& entregar) {
+        for (size_t k = 0; k < rutas.size(); k++) {
+            ifstream entrada(rutas[k], ios::binary | ios::ate);
+            if (!entrada) {
+                entregar(archivoConError(k, "No se encuentra el audio WAV"));
+                continue;
+            }
+            unique_ptr<ArchivoLeido> archivo = archivoConError(k, "");
+            archivo->datos.resize(static_cast<size_t>(entrada.tellg()));
+            entrada.seekg(0);
+            entrada.read(reinterpret_cast<char*>(archivo->datos.data()), archivo->datos.size());
+            if (!entrada) archivo->error = "No se puede leer el audio WAV";
+            entregar(move(archivo));
+        }
+    }
+
+#ifdef USAR_IO_URING
+    // Archivo en lectura dentro de una de las ranuras del anillo
+    struct Ranura {
+        int fd = -1;
+        size_t leidos = 0;                  // bytes ya escritos por el kernel en archivo->datos
+        unique_ptr<ArchivoLeido> archivo;
+    };
+
+    void iniciarAnillo() {
+        io_uring_params parametros;
+        memset(&parametros, 0, sizeof(parametros));
+        int fd = static_cast<int>(syscall(__NR_io_uring_setup, profundidad_, &parametros));
+        if (fd < 0) return;
+
+        sq_tamano_ = parametros.sq_off.array + parametros.sq_entries * sizeof(unsigned);
+        cq_tamano_ = parametros.cq_off.cqes + parametros.cq_entries * sizeof(io_uring_cqe);
+        bool mapa_unico = (parametros.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (mapa_unico) sq_tamano_ = cq_tamano_ = max(sq_tamano_, cq_tamano_);
+
+        void* sq = mmap(NULL, sq_tamano_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        void* cq = mapa_unico ? sq : mmap(NULL, cq_tamano_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        void* sqes = mmap(NULL, parametros.sq_entries * sizeof(io_uring_sqe), PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+        if (sq == MAP_FAILED || cq == MAP_FAILED || sqes == MAP_FAILED) {
+            if (sqes != MAP_FAILED) munmap(sqes, parametros.sq_entries * sizeof(io_uring_sqe));
+            if (cq != MAP_FAILED && cq != sq) munmap(cq, cq_tamano_);
+            if (sq != MAP_FAILED) munmap(sq, sq_tamano_);
+            close(fd);
+            return;
+        }
+
+        sq_ptr_ = static_cast<uint8_t*>(sq);
+        cq_ptr_ = static_cast<uint8_t*>(cq);
+        sqes_ = static_cast<io_uring_sqe*>(sqes);
+        num_sqes_ = parametros.sq_entries;
+        sq_cola_ = reinterpret_cast<unsigned*>(sq_ptr_ + parametros.sq_off.tail);
+        sq_mascara_ = reinterpret_cast<unsigned*>(sq_ptr_ + parametros.sq_off.ring_mask);
+        sq_arreglo_ = reinterpret_cast<unsigned*>(sq_ptr_ + parametros.sq_off.array);
+        cq_cabeza_ = reinterpret_cast<unsigned*>(cq_ptr_ + parametros.cq_off.head);
+        cq_cola_ = reinterpret_cast<unsigned*>(cq_ptr_ + parametros.cq_off.tail);
+        cq_mascara_ = reinterpret_cast<unsigned*>(cq_ptr_ + parametros.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(cq_ptr_ + parametros.cq_off.cqes);
+        anillo_fd_ = fd;
+        ranuras_.resize(profundidad_);
+    }
+
+    // Encola la lectura del siguiente tramo del archivo de la ranura r, directo a su buffer
+    void encolarLectura(unsigned int r) {
+        Ranura& ranura = ranuras_[r];
+        vector<uint8_t>& datos = ranura.archivo->datos;
+        unsigned cola = *sq_cola_;
+        unsigned posicion = cola & *sq_mascara_;
+        io_uring_sqe& sqe = sqes_[posicion];
+        memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_READ;
+        sqe.fd = ranura.fd;
+        sqe.addr = reinterpret_cast<uint64_t>(datos.data() + ranura.leidos);
+        sqe.len = static_cast<uint32_t>(min(tam_bloque_, datos.size() - ranura.leidos));
+        sqe.off = ranura.leidos;
+        sqe.user_data = r;
+        sq_arreglo_[posicion] = posicion;
+        __atomic_store_n(sq_cola_, cola + 1, __ATOMIC_RELEASE);
+        pendientes_envio_++;
+    }
+
+    // Abre el siguiente archivo del lote en la ranura r; false si ya no quedan
+    bool abrirSiguiente(unsigned int r, size_t& siguiente, const vector<string>& rutas, const Entrega& entregar) {
+        Ranura& ranura = ranuras_[r];
+        while (siguiente < rutas.size()) {
+            size_t k = siguiente++;
+            int fd = open(rutas[k].c_str(), O_RDONLY);
+            struct stat info;
+            if (fd < 0 || fstat(fd, &info) != 0) {
+                if (fd >= 0) close(fd);
+                entregar(archivoConError(k, "No se encuentra el audio WAV"));
+                continue;
+            }
+
+            ranura.fd = fd;
+            ranura.leidos = 0;
+            ranura.archivo = archivoConError(k, "");
+            ranura.archivo->datos.resize(static_cast<size_t>(info.st_size));
+            if (info.st_size == 0) {
+                terminarArchivo(r, entregar, "El audio WAV está vacío");
+                continue;
+            }
+            encolarLectura(r);
+            return true;
+        }
+        return false;
+    }
+
+    void terminarArchivo(unsigned int r, const Entrega& entregar, const string& error) {
+        Ranura& ranura = ranuras_[r];
+        close(ranura.fd);
+        ranura.fd = -1;
+        ranura.archivo->error = error;
+        entregar(move(ranura.archivo));
+    }
+
+    void leerConAnillo(const vector<string>& rutas, const Entrega& entregar) {
+        size_t siguiente = 0;
+        unsigned int activas = 0;
+        for (unsigned int r = 0; r < profundidad_; r++) {
+            if (abrirSiguiente(r, siguiente, rutas, entregar)) activas++;
+        }
+
+        while (activas > 0) {
+            // Enviar lo encolado y esperar al menos una lectura terminada
+            int enviadas = static_cast<int>(syscall(__NR_io_uring_enter, anillo_fd_, pendientes_envio_, 1,
+                                                    IORING_ENTER_GETEVENTS, NULL, 0));
+            if (enviadas < 0) {
+                if (errno == EINTR) continue;
+                throw runtime_error("Error de io_uring al leer el lote");
+            }
+            pendientes_envio_ -= static_cast<unsigned int>(enviadas);
+
+            unsigned cabeza = *cq_cabeza_;
+            while (cabeza != __atomic_load_n(cq_cola_, __ATOMIC_ACQUIRE)) {
+                io_uring_cqe cqe = cqes_[cabeza & *cq_mascara_];
+                __atomic_store_n(cq_cabeza_, ++cabeza, __ATOMIC_RELEASE);
+
+                unsigned int r = static_cast<unsigned int>(cqe.user_data);
+                Ranura& ranura = ranuras_[r];
+                if (cqe.res > 0) {
+                    ranura.leidos += static_cast<size_t>(cqe.res);
+                    if (ranura.leidos < ranura.archivo->datos.size()) {
+                        encolarLectura(r);
+                        continue;
+                    }
+                    terminarArchivo(r, entregar, "");
+                } else {
+                    terminarArchivo(r, entregar, "No se puede leer el audio WAV");
+                }
+
+                if (!abrirSiguiente(r, siguiente, rutas, entregar)) activas--;
+            }
+        }
+    }
+
+    vector<Ranura> ranuras_;
+    uint8_t* sq_ptr_ = nullptr;
+    uint8_t* cq_ptr_ = nullptr;
+    size_t sq_tamano_ = 0;
+    size_t cq_tamano_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+    unsigned num_sqes_ = 0;
+    unsigned* sq_cola_ = nullptr;
+    unsigned* sq_mascara_ = nullptr;
+    unsigned* sq_arreglo_ = nullptr;
+    unsigned* cq_cabeza_ = nullptr;
+    unsigned* cq_cola_ = nullptr;
+    unsigned* cq_mascara_ = nullptr;
+    io_uring_cqe* cqes_ = nullptr;
+    unsigned int pendientes_envio_ = 0;
+#endif
+
+    unsigned int profundidad_;
+    size_t tam_bloque_;
+    int anillo_fd_ = -1;
+};
+
+// Lectura de audio con un vector por canal
+vector <vector <double>> cargar_canales_wav (const char* filename) {
+
+    WavStream flujo(ruta_audio(filename));
+
+    vector <vector <double>> canales(flujo.canales());
+    for (auto& canal : canales)
+        canal.reserve(flujo.totalCuadros());
+
+    vector <vector <double>> bloque;
+    while (flujo.siguienteBloque(bloque)) {
+        for (size_t c = 0; c < canales.size(); c++)
+            canales[c].insert(canales[c].end(), bloque[c].begin(), bloque[c].end());
+    }
+
+    return canales;
+}
+
+
+// Archivo proyectado en memoria de solo lectura (en Windows se lee completo a un buffer)
+class ArchivoMapeado {
+public:
+    explicit ArchivoMapeado(const string& ruta) {
+#ifndef _WIN32
+        int fd = open(ruta.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw runtime_error("No se encuentra el audio WAV");
+
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+            close(fd);
+            throw runtime_error("No se puede leer el audio WAV");
+        }
+        tamano_ = static_cast<size_t>(info.st_size);
+
+        void* mapa = mmap(NULL, tamano_, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (mapa == MAP_FAILED)
+            throw runtime_error("No se puede mapear el audio WAV");
+
+        // Lectura secuencial: el kernel puede adelantar páginas y liberarlas pronto
+        madvise(mapa, tamano_, MADV_SEQUENTIAL);
+        datos_ = static_cast<const uint8_t*>(mapa);
+#else
+        ifstream archivo(ruta, ios::binary | ios::ate);
+        if (!archivo)
+            throw runtime_error("No se encuentra el audio WAV");
+        respaldo_.resize(static_cast<size_t>(archivo.tellg()));
+        archivo.seekg(0);
+        archivo.read(reinterpret_cast<char*>(respaldo_.data()), respaldo_.size());
+        datos_ = respaldo_.data();
+        tamano_ = respaldo_.size();
+#endif
+    }
+
+    ~ArchivoMapeado() {
+#ifndef _WIN32
+        if (datos_) munmap(const_cast<uint8_t*>(datos_), tamano_);
+#endif
+    }
+
+    ArchivoMapeado(const ArchivoMapeado&) = delete;
+    ArchivoMapeado& operator=(const ArchivoMapeado&) = delete;
+
+    const uint8_t* datos() const { return datos_; }
+    size_t tamano() const { return tamano_; }
+
+private:
+    const uint8_t* datos_ = nullptr;
+    size_t tamano_ = 0;
+#ifdef _WIN32
+    vector<uint8_t> respaldo_;
+#endif
+};
+
+// Vista de solo lectura sobre las muestras del audio, en su formato original
+struct VistaPCM {
+    const void* datos = nullptr;
+    size_t cantidad = 0;
+    FormatoMuestras formato = FormatoMuestras::S16;
+};
+
+/*
+Audio WAV leído sin copias: el archivo se mapea en memoria y se abre con
+drwav_init_memory. Si el formato es PCM de 16/32 bits o flotante de 32/64 bits,
+las muestras se leen directamente del chunk "data" del archivo mapeado; en otro
+caso (24 bits, A-law, ADPCM...) se decodifican una sola vez a double.
+La normalización se hace al consultar las muestras. En audios multicanal las
+muestras están entrelazadas (cuadro a cuadro).
+*/
+class AudioMapeado {
+public:
+    explicit AudioMapeado(const string& ruta) : archivo_(ruta) {
+        if (!drwav_init_memory(&wav_, archivo_.datos(), archivo_.tamano(), NULL))
+            throw runtime_error("No se encuentra el audio WAV");
+
+        size_t total_muestras = static_cast<size_t>(wav_.totalPCMFrameCount) * wav_.channels;
+
+        size_t bytes_muestra = 0;
+        if (wav_.translatedFormatTag == DR_WAVE_FORMAT_PCM && wav_.bitsPerSample == 16) {
+            vista_.formato = FormatoMuestras::S16;
+            bytes_muestra = sizeof(int16_t);
+        } else if (wav_.translatedFormatTag == DR_WAVE_FORMAT_PCM && wav_.bitsPerSample == 32) {
+            vista_.formato = FormatoMuestras::S32;
+            bytes_muestra = sizeof(int32_t);
+        } else if (wav_.translatedFormatTag == DR_WAVE_FORMAT_IEEE_FLOAT && wav_.bitsPerSample == 32) {
+            vista_.formato = FormatoMuestras::F32;
+            bytes_muestra = sizeof(float);
+        } else if (wav_.translatedFormatTag == DR_WAVE_FORMAT_IEEE_FLOAT && wav_.bitsPerSample == 64) {
+            vista_.formato = FormatoMuestras::F64;
+            bytes_muestra = sizeof(double);
+        }
+
+        if (bytes_muestra != 0 && wav_.dataChunkDataPos % bytes_muestra == 0 && esLittleEndian()) {
+            // El chunk puede venir truncado: solo se exponen las muestras presentes
+            size_t disponibles = (archivo_.tamano() - wav_.dataChunkDataPos) / bytes_muestra;
+            vista_.datos = archivo_.datos() + wav_.dataChunkDataPos;
+            vista_.cantidad = min(total_muestras, disponibles);
+            vista_.cantidad -= vista_.cantidad % wav_.channels;
+        } else {
+            decodificado_.resize(total_muestras);
+            BufferDecodificacion temporal;
+            size_t leidos = leerNormalizado(wav_, formatoDecodificacion(wav_), temporal,
+                                            wav_.totalPCMFrameCount, decodificado_.data());
+            decodificado_.resize(leidos * wav_.channels);
+            vista_.datos = decodificado_.data();
+            vista_.cantidad = decodificado_.size();
+            vista_.formato = FormatoMuestras::F64;
+        }
+    }
+
+    ~AudioMapeado() { drwav_uninit(&wav_); }
+
+    AudioMapeado(const AudioMapeado&) = delete;
+    AudioMapeado& operator=(const AudioMapeado&) = delete;
+
+    const drwav& wav() const { return wav_; }
+    const VistaPCM& vista() const { return vista_; }
+    bool esCopiaCero() const { return decodificado_.empty() && vista_.cantidad > 0; }
+    size_t numMuestras() const { return vista_.cantidad; }
+    size_t numCuadros() const { return vista_.cantidad / wav_.channels; }
+    size_t canales() const { return wav_.channels; }
+
+    double muestra(size_t i) const {
+        double valor;
+        normalizarRango(i, 1, &valor);
+        return valor;
+    }
+
+    // Normaliza las muestras [inicio, inicio + n) en destino
+    void normalizarRango(size_t inicio, size_t n, double* destino) const {
+        switch (vista_.formato) {
+            case FormatoMuestras::S16:
+                normalizar(static_cast<const int16_t*>(vista_.datos) + inicio, n, destino);
+                break;
+            case FormatoMuestras::S32:
+                normalizar(static_cast<const int32_t*>(vista_.datos) + inicio, n, destino);
+                break;
+            case FormatoMuestras::F32:
+                normalizar(static_cast<const float*>(vista_.datos) + inicio, n, destino);
+                break;
+            case FormatoMuestras::F64:
+                normalizar(static_cast<const double*>(vista_.datos) + inicio, n, destino);
+                break;
+        }
+    }
+
+private:
+    static bool esLittleEndian() {
+        const uint16_t uno = 1;
+        return *reinterpret_cast<const uint8_t*>(&uno) == 1;
+    }
+
+    ArchivoMapeado archivo_;
+    drwav wav_;   // no se copia: drwav_init_memory guarda un puntero a su propio memoryStream
+    VistaPCM vista_;
+    vector<double> decodificado_;
+};
+
+/*
+Decodificación paralela de un WAV: en formatos sin compresión (PCM, flotante,
+A-law, mu-law) cada cuadro ocupa los mismos bytes, así que el chunk "data" se
+divide en rangos y cada hilo abre su propio decodificador sobre el archivo
+mapeado, salta a su primer cuadro y escribe en su parte de la salida.
+ADPCM se decodifica en serie. Un audio multicanal se mezcla a un canal.
+Si el archivo está truncado, cualquier rango puede quedar corto: la salida se
+corta en el primer cuadro que no se pudo leer, nunca quedan huecos en cero.
+*/
+vector<double> decodificarWavParalelo(const string& ruta, unsigned int hilos = 0) {
+    ArchivoMapeado archivo(ruta);
+
+    drwav wav;
+    if (!drwav_init_memory(&wav, archivo.datos(), archivo.tamano(), NULL))
+        throw runtime_error("No se encuentra el audio WAV");
+    size_t cuadros = wav.totalPCMFrameCount;
+    size_t canales = wav.channels;
+    FormatoMuestras formato = formatoDecodificacion(wav);
+    bool comprimido = wav.translatedFormatTag == DR_WAVE_FORMAT_ADPCM ||
+                      wav.translatedFormatTag == DR_WAVE_FORMAT_DVI_ADPCM;
+    drwav_uninit(&wav);
+
+    vector<double> salida(cuadros);
+    // Menor cuadro en el que algún rango se quedó sin datos
+    atomic<size_t> fin_valido{cuadros};
+    auto marcarCorte = [&](size_t posicion) {
+        size_t actual = fin_valido.load();
+        while (posicion < actual && !fin_valido.compare_exchange_weak(actual, posicion)) {}
+    };
+
+    auto decodificarRango = [&](size_t inicio, size_t fin) {
+        drwav lector;
+        if (!drwav_init_memory(&lector, archivo.datos(), archivo.tamano(), NULL))
+            throw runtime_error("No se puede leer el audio WAV");
+        if (inicio > 0 && !drwav_seek_to_pcm_frame(&lector, inicio)) {
+            // El rango empieza más allá del final real del archivo
+            drwav_uninit(&lector);
+            marcarCorte(inicio);
+            return;
+        }
+
+        const size_t TAM_BLOQUE = 4096;
+        BufferDecodificacion temporal;
+        vector<double> entrelazado(canales > 1 ? TAM_BLOQUE * canales : 0);
+        size_t posicion = inicio;
+        while (posicion < fin) {
+            size_t n = min(TAM_BLOQUE, fin - posicion);
+            size_t leidos;
+            if (canales == 1) {
+                leidos = leerNormalizado(lector, formato, temporal, n, salida.data() + posicion);
+            } else {
+                leidos = leerNormalizado(lector, formato, temporal, n, entrelazado.data());
+                mezclarCanales(entrelazado.data(), leidos, canales, salida.data() + posicion);
+            }
+            posicion += leidos;
+            if (leidos < n) {   // archivo truncado
+                marcarCorte(posicion);
+                break;
+            }
+        }
+        drwav_uninit(&lector);
+    };
+
+    if (comprimido) {
+        decodificarRango(0, cuadros);
+    } else {
+        ejecutarEnParalelo(cuadros, hilos, decodificarRango);
+    }
+
+    salida.resize(fin_valido.load());
+    return salida;
+}
+
+// Lectura de audio decodificada en paralelo (mismo resultado que cargar_normalizar_wav)
+vector <double> cargar_normalizar_wav_paralelo (const char* filename, unsigned int hilos = 0) {
+    return decodificarWavParalelo(ruta_audio(filename), hilos);
+}
+
+// Separa un audio mapeado en un vector normalizado por canal, bloque a bloque
+vector<vector<double>> desentrelazarCanales(const AudioMapeado& audio) {
+    size_t canales = audio.canales();
+    size_t cuadros = audio.numCuadros();
+    vector<vector<double>> planos(canales, vector<double>(cuadros));
+
+    const size_t TAM_BLOQUE = 4096;
+    vector<double> entrelazado(TAM_BLOQUE * canales);
+    vector<double*> destinos(canales);
+    for (size_t inicio = 0; inicio < cuadros; inicio += TAM_BLOQUE) {
+        size_t n = min(TAM_BLOQUE, cuadros - inicio);
+        audio.normalizarRango(inicio * canales, n * canales, entrelazado.data());
+        for (size_t c = 0; c < canales; ++c) destinos[c] = planos[c].data() + inicio;
+        desentrelazar(entrelazado.data(), n, canales, destinos.data());
+    }
+    return planos;
+}
+
+
+// Plan de la FFT: factores de giro e^{-2πik/N} (k < N/2), calculados una vez por tamaño
+shared_ptr<const vector<complex<double>>> planFFT(size_t N) {
+    static mutex candado;
+    static map<size_t, shared_ptr<const vector<complex<double>>>> planes;
+
+    lock_guard<mutex> bloqueo(candado);
+    auto encontrado = planes.find(N);
+    if (encontrado != planes.end()) return encontrado->second;
+
+    auto giros = make_shared<vector<complex<double>>>(N / 2);
+    for (size_t k = 0; k < N / 2; ++k) {
+        (*giros)[k] = polar(1.0, -2.0 * PI * k / static_cast<double>(N));
+    }
+    planes[N] = giros;
+    return giros;
+}
+
+// Radix-2 recursiva sobre x[0], x[paso], x[2*paso]... usando el plan del tamaño original
+void fftRecursiva(const complex<double>* x, size_t N, size_t paso, complex<double>* F,
+                  const vector<complex<double>>& giros, size_t paso_giro) {
+    if (N == 1) {
+        F[0] = x[0];
+        return;
+    }
+
+    // FFT de pares en la primera mitad de F e impares en la segunda
+    fftRecursiva(x, N / 2, 2 * paso, F, giros, 2 * paso_giro);
+    fftRecursiva(x + paso, N / 2, 2 * paso, F + N / 2, giros, 2 * paso_giro);
+
+    // Combinar resultados
+    for (size_t k = 0; k < N / 2; ++k) {
+        complex<double> e = F[k];
+        complex<double> t = giros[k * paso_giro] * F[k + N / 2];
+
+        F[k]         = e + t;
+        F[k + N / 2] = e - t;
+    }
+}
+
+// FFT
+vector<complex<double>> fft(const vector<complex<double>>& x) {
+    size_t N = x.size();
+    if (N <= 1) return x;
+    
+    // Verificar que N sea potencia de 2
+    if ((N & (N - 1)) != 0) {
+        throw runtime_error("FFT requiere que el tamaño sea potencia de 2");
+    }
+
+    shared_ptr<const vector<complex<double>>> giros = planFFT(N);
+    vector<complex<double>> F(N);
+    fftRecursiva(x.data(), N, 1, F.data(), *giros, 1);
+    return F;
+}
+
+vector<complex<double>> fft_real(const vector<double>& x) {
+    vector<complex<double>> xc(x.size());
+    for (size_t i = 0; i < x.size(); ++i) {
+        xc[i] = complex<double>(x[i], 0.0);   // parte imaginaria = 0
+    }
+    return fft(xc);
+}
+
+// Calcula la siguiente potencia de 2 mayor o igual a n (para zero-padding)
+size_t siguiente_potencia2(size_t n) {
+    size_t p = 1;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+// Recibe la señal normalizada en el tiempo y devuelve el espectro listo para filtrar
+vector<complex<double>> obtenerEspectroParaFiltrado(const vector<double>& senalTiempo) {
+    // Copiar y rellenar con ceros hasta la siguiente potencia de 2
+    vector<double> senal = senalTiempo;
+    size_t N_fft = siguiente_potencia2(senal.size());
+    senal.resize(N_fft, 0.0);
+
+    // Aplicar FFT
+    vector<complex<double>> espectro = fft_real(senal);
+    return espectro;
+}
+
+// Igual que la anterior, pero normaliza las muestras directamente desde el audio mapeado (MONO)
+vector<complex<double>> obtenerEspectroParaFiltrado(const AudioMapeado& audio) {
+    if (audio.canales() != 1)
+        throw runtime_error("El espectro directo solo permite audio de 1 canal (MONO)");
+
+    size_t N_fft = siguiente_potencia2(audio.numMuestras());
+    vector<complex<double>> senal(N_fft, complex<double>(0.0, 0.0));
+
+    // Normalizar por bloques para no copiar la señal completa; cada hilo toma un rango
+    ejecutarEnParalelo(audio.numMuestras(), 0, [&](size_t inicio_rango, size_t fin_rango) {
+        const size_t TAM_BLOQUE = 4096;
+        double bloque[TAM_BLOQUE];
+        for (size_t inicio = inicio_rango; inicio < fin_rango; inicio += TAM_BLOQUE) {
+            size_t n = min(TAM_BLOQUE, fin_rango - inicio);
+            audio.normalizarRango(inicio, n, bloque);
+            for (size_t i = 0; i < n; ++i) {
+                senal[inicio + i] = complex<double>(bloque[i], 0.0);
+            }
+        }
+    });
+    return fft(senal);
+}
+
+
+// Banda de frecuencias cardiacas que conserva el filtro (Hz)
+const double FRECUENCIA_FILTRO_MIN = 0.5;
+const double FRECUENCIA_FILTRO_MAX = 3.5;
+
+// Bins [k_min, k_max] de la mitad positiva del espectro que conserva el filtro
+struct BandaFiltro {
+    size_t k_min;
+    size_t k_max;   // si k_min > k_max no se conserva ningún bin
+};
+
+// Banda del filtro para un tamaño de FFT y una frecuencia de muestreo, calculada una vez por par
+BandaFiltro bandaFiltro(size_t n, double fs) {
+    static mutex candado;
+    static map<pair<size_t, double>, BandaFiltro> bandas;
+
+    lock_guard<mutex> bloqueo(candado);
+    auto encontrada = bandas.find({n, fs});
+    if (encontrada != bandas.end()) return encontrada->second;
+
+    double minFreq = FRECUENCIA_FILTRO_MIN;
+    double maxFreq = FRECUENCIA_FILTRO_MAX;
+    BandaFiltro banda = {1, 0};
+    bool vacia = true;
+    for (size_t i = 0; i <= n / 2; i++) {
+        double freq = (i * fs) / n;
+        if (freq >= minFreq && freq <= maxFreq) {
+            if (vacia) banda.k_min = i;
+            banda.k_max = i;
+            vacia = false;
+        }
+    }
+    bandas[{n, fs}] = banda;
+    return banda;
+}
+
+// Filtrado de frecuencias cardiacas
+void filtrarFrecuencias(vector<complex<double>>& fft, double fs) { // fs = frecuencia de muestreo
+    size_t n = fft.size();
+    if (n == 0) return;
+    BandaFiltro banda = bandaFiltro(n, fs);
+
+    // Anular todo lo que queda fuera de la banda, en frecuencias positivas y negativas
+    for (size_t i = 0; i <= n / 2; i++) {
+        if (i < banda.k_min || i > banda.k_max) {
+            fft[i] = {0.0, 0.0};
+
+            if (i != 0 && i != n / 2)
+                fft[n - i] = {0.0, 0.0};
+        }
+    }
+}
+
+
+// IFFT
+vector<complex<double>> ifft(const vector<complex<double>>& X) 
+{
+    size_t N = X.size();
+    if (N <= 1) return X; 
+    //Verificar que N sea potencia de 2
+    // usen try-catch para probar 
+    if ((N & (N - 1)) != 0)
+    {
+        throw runtime_error("IFFT requiere que el tamaño sea potencia de 2");
+    }
+    // Conjugar las muestras de entrada
+    vector<complex<double>> X_conj(N);
+    for (size_t i = 0; i < N; ++i) 
+    {
+        X_conj[i] = conj(X[i]);
+    }
+    //fft a las muestras
+    vector<complex<double>> x_conj = fft(X_conj);
+    // Conjugar el resultado y dividir por N
+    vector<complex<double>> x(N);
+    for (size_t i = 0; i < N; ++i) 
+    {
+        x[i] = conj(x_conj[i]) / static_cast<double>(N);
+    }
+    return x;
+}
+/*
+Para extraer la parte real despues de de la ifft
+*/
+vector<double> ifft_real(const vector<complex<double>>& X) {
+    vector<complex<double>> resultado = ifft(X);
+    vector<double> real(resultado.size());
+    for (size_t i = 0; i < resultado.size(); ++i) 
+    {
+        real[i] = resultado[i].real();
+    }
+    return real;
+}
+
+// Señal filtrada reconstruida a una frecuencia de muestreo reducida
+struct SenalDecimada {
+    vector<double> muestras;
+    double frecuencia_muestreo;   // frecuencia de muestreo de la señal reducida
+    size_t factor;                // la muestra m equivale a la muestra m * factor original
+};
+
+/*
+IFFT decimada: tras filtrarFrecuencias todo el contenido queda por debajo de unos
+pocos Hz, así que basta con conservar los bins bajos del espectro (truncado a la
+menor potencia de 2 que cubre la banda) y aplicar una IFFT mucho más pequeña.
+El resultado coincide con ifft_real(X) muestreado cada 'factor' muestras.
+*/
+SenalDecimada ifft_real_decimada(const vector<complex<double>>& X, double fs, double fs_minima = 100.0) {
+    size_t N = X.size();
+    if ((N & (N - 1)) != 0) {
+        throw runtime_error("IFFT requiere que el tamaño sea potencia de 2");
+    }
+
+    // Bin no nulo más alto de la mitad positiva del espectro
+    size_t k_max = 0;
+    for (size_t k = N / 2; k > 0; --k) {
+        if (X[k] != complex<double>(0.0, 0.0)) {
+            k_max = k;
+            break;
+        }
+    }
+
+    // Menor tamaño que deja k_max por debajo de Nyquist y respeta fs_minima
+    size_t M = siguiente_potencia2(2 * k_max + 2);
+    if (fs > 0 && fs_minima > 0) {
+        M = max(M, siguiente_potencia2(static_cast<size_t>(ceil(fs_minima * N / fs))));
+    }
+
+    SenalDecimada resultado;
+    if (M >= N) {
+        resultado.muestras = ifft_real(X);
+        resultado.frecuencia_muestreo = fs;
+        resultado.factor = 1;
+        return resultado;
+    }
+
+    // Copiar frecuencias positivas y negativas al espectro reducido
+    vector<complex<double>> Y(M, complex<double>(0.0, 0.0));
+    for (size_t k = 0; k < M / 2; ++k) {
+        Y[k] = X[k];
+        if (k != 0) Y[M - k] = X[N - k];
+    }
+
+    // ifft divide entre M en lugar de N
+    resultado.muestras = ifft_real(Y);
+    double escala = static_cast<double>(M) / N;
+    for (double& v : resultado.muestras) v *= escala;
+
+    resultado.factor = N / M;
+    resultado.frecuencia_muestreo = fs / resultado.factor;
+    return resultado;
+}
+
+
+/*
+Caché de la señal filtrada: archivo auxiliar junto al WAV (ruta + ".fcc") con la
+señal ya filtrada y decimada, para que los análisis repetidos de un mismo audio
+(p. ej. con otro umbral) pasen directo a la detección de picos.
+Disposición, en el orden de bytes de la máquina:
+  CabeceraCache
+  IndiceTrozo[num_trozos]     acceso por tiempo sin recorrer la señal
+  float[num_muestras]         señal decimada
+  float[2 * num_bins]         opcional: bins [bin_inicial, bin_inicial + num_bins) del espectro filtrado
+La caché lleva un hash del contenido del WAV y otro de los parámetros del pipeline;
+si alguno no coincide se descarta y se vuelve a escribir.
+*/
+const uint32_t VERSION_CACHE = 1;
+
+struct CabeceraCache {
+    char magia[4];                  // "FCC\0"
+    uint32_t version;
+    uint64_t hash_contenido;
+    uint64_t hash_parametros;
+    double frecuencia_muestreo;     // de la señal decimada
+    uint64_t factor;
+    uint64_t muestras_originales;
+    uint64_t num_muestras;
+    uint64_t muestras_por_trozo;
+    uint64_t num_trozos;
+    uint64_t tamano_fft;
+    uint64_t bin_inicial;
+    uint64_t num_bins;              // 0 si no se guardó el espectro
+};
+
+struct IndiceTrozo {
+    double tiempo_inicio;           // segundos desde el inicio de la señal
+    uint64_t desplazamiento;        // bytes desde el inicio del archivo de caché
+};
+
+string rutaCache(const string& ruta_wav) {
+    return ruta_wav + ".fcc";
+}
+
+// Hash FNV-1a de 64 bits, por palabras de 8 bytes
+uint64_t hashFNV(const void* datos, size_t tamano, uint64_t hash = 1469598103934665603ull) {
+    const uint64_t primo = 1099511628211ull;
+    const uint8_t* bytes = static_cast<const uint8_t*>(datos);
+    size_t i = 0;
+    for (; i + 8 <= tamano; i += 8) {
+        uint64_t palabra;
+        memcpy(&palabra, bytes + i, 8);
+        hash = (hash ^ palabra) * primo;
+    }
+    for (; i < tamano; i++) hash = (hash ^ bytes[i]) * primo;
+    return hash;
+}
+
+/*
+Huella del WAV que identifica su caché. Por defecto es barata: tamaño, fecha de
+modificación y hash de los primeros y últimos 64 KiB (la cabecera cae en el
+primero), así que abrir la caché de un archivo grande no lo lee entero. Con
+completa = true se usa el hash FNV de todo el contenido, para quien necesite
+detectar cambios en medio del archivo que conserven tamaño y fecha.
+*/
+uint64_t huellaContenido(const string& ruta, bool completa = false) {
+    if (completa) {
+        ArchivoMapeado archivo(ruta);
+        return hashFNV(archivo.datos(), archivo.tamano());
+    }
+
+    ifstream entrada(ruta, ios::binary | ios::ate);
+    if (!entrada)
+        throw runtime_error("No se encuentra el audio WAV");
+    uint64_t tamano = static_cast<uint64_t>(entrada.tellg());
+    int64_t modificacion = 0;
+#ifndef _WIN32
+    struct stat info;
+    if (stat(ruta.c_str(), &info) == 0) modificacion = static_cast<int64_t>(info.st_mtime);
+#endif
+
+    const uint64_t TAM_TRAMO = 64 * 1024;
+    vector<char> tramo(static_cast<size_t>(min(tamano, TAM_TRAMO)));
+    const uint64_t metadatos[] = {tamano, static_cast<uint64_t>(modificacion)};
+    uint64_t hash = hashFNV(metadatos, sizeof(metadatos));
+    for (uint64_t desde : {uint64_t(0), tamano - tramo.size()}) {
+        entrada.seekg(static_cast<streamoff>(desde));
+        entrada.read(tramo.data(), tramo.size());
+        if (!entrada)
+            throw runtime_error("No se puede leer el audio WAV");
+        hash = hashFNV(tramo.data(), tramo.size(), hash);
+    }
+    return hash;
+}
+
+// Hash de los parámetros que determinan la señal guardada en la caché
+uint64_t hashParametrosPipeline(double fs_minima) {
+    const double parametros[] = {static_cast<double>(VERSION_CACHE), FRECUENCIA_FILTRO_MIN, FRECUENCIA_FILTRO_MAX, fs_minima};
+    return hashFNV(parametros, sizeof(parametros));
+}
+
+// Escribe la caché en un archivo temporal y lo renombra, para no dejar cachés a medias
+void escribirCacheDecimada(const string& ruta, const SenalDecimada& senal, uint64_t hash_contenido, uint64_t hash_parametros,
+                           size_t muestras_originales, const vector<complex<double>>* espectro = nullptr,
+                           size_t muestras_por_trozo = 4096) {
+    if (muestras_por_trozo == 0)
+        throw runtime_error("El tamaño de trozo debe ser mayor que 0");
+
+    CabeceraCache cabecera = {};
+    memcpy(cabecera.magia, "FCC", 4);
+    cabecera.version = VERSION_CACHE;
+    cabecera.hash_contenido = hash_contenido;
+    cabecera.hash_parametros = hash_parametros;
+    cabecera.frecuencia_muestreo = senal.frecuencia_muestreo;
+    cabecera.factor = senal.factor;
+    cabecera.muestras_originales = muestras_originales;
+    cabecera.num_muestras = senal.muestras.size();
+    cabecera.muestras_por_trozo = muestras_por_trozo;
+    cabecera.num_trozos = (senal.muestras.size() + muestras_por_trozo - 1) / muestras_por_trozo;
+
+    // Solo se guarda la parte no nula de la mitad positiva del espectro
+    if (espectro && !espectro->empty()) {
+        size_t n = espectro->size();
+        size_t primero = 0, ultimo = 0;
+        bool vacio = true;
+        for (size_t k = 0; k <= n / 2; k++) {
+            if ((*espectro)[k] != complex<double>(0.0, 0.0)) {
+                if (vacio) primero = k;
+                ultimo = k;
+                vacio = false;
+            }
+        }
+        cabecera.tamano_fft = n;
+        cabecera.bin_inicial = primero;
+        cabecera.num_bins = vacio ? 0 : ultimo - primero + 1;
+    }
+
+    vector<IndiceTrozo> indice(cabecera.num_trozos);
+    uint64_t inicio_senal = sizeof(CabeceraCache) + indice.size() * sizeof(IndiceTrozo);
+    for (size_t t = 0; t < indice.size(); t++) {
+        indice[t].tiempo_inicio = (t * muestras_por_trozo) / senal.frecuencia_muestreo;
+        indice[t].desplazamiento = inicio_senal + t * muestras_por_trozo * sizeof(float);
+    }
+
+    vector<float> muestras(senal.muestras.begin(), senal.muestras.end());
+    vector<float> bins(2 * cabecera.num_bins);
+    for (size_t k = 0; k < cabecera.num_bins; k++) {
+        const complex<double>& valor = (*espectro)[cabecera.bin_inicial + k];
+        bins[2 * k] = static_cast<float>(valor.real());
+        bins[2 * k + 1] = static_cast<float>(valor.imag());
+    }
+
+    string temporal = ruta + ".tmp";
+    {
+        ofstream salida(temporal, ios::binary | ios::trunc);
+        salida.write(reinterpret_cast<const char*>(&cabecera), sizeof(cabecera));
+        salida.write(reinterpret_cast<const char*>(indice.data()), indice.size() * sizeof(IndiceTrozo));
+        salida.write(reinterpret_cast<const char*>(muestras.data()), muestras.size() * sizeof(float));
+        salida.write(reinterpret_cast<const char*>(bins.data()), bins.size() * sizeof(float));
+        if (!salida) {
+            salida.close();
+            remove(temporal.c_str());
+            throw runtime_error("No se pudo escribir la caché");
+        }
+    }
+    remove(ruta.c_str());   // en Windows rename no reemplaza un archivo existente
+    if (rename(temporal.c_str(), ruta.c_str()) != 0) {
+        remove(temporal.c_str());
+        throw runtime_error("No se pudo escribir la caché");
+    }
+}
+
+// Caché proyectada en memoria; las muestras se leen directamente del archivo
+class CacheDecimada {
+public:
+    // Lanza excepción si el archivo no existe o no es una caché válida de esta versión
+    explicit CacheDecimada(const string& ruta) : archivo_(ruta) {
+        if (archivo_.tamano() < sizeof(CabeceraCache))
+            throw runtime_error("Caché incompleta");
+        memcpy(&cabecera_, archivo_.datos(), sizeof(cabecera_));
+        if (memcmp(cabecera_.magia, "FCC", 4) != 0 || cabecera_.version != VERSION_CACHE)
+            throw runtime_error("Formato de caché no reconocido");
+        if (cabecera_.muestras_por_trozo == 0 || cabecera_.factor == 0 || !(cabecera_.frecuencia_muestreo > 0))
+            throw runtime_error("Cabecera de caché inválida");
+
+        // Los tamaños se comprueban antes de multiplicar para no desbordar con una cabecera corrupta
+        uint64_t maximo = archivo_.tamano();
+        if (cabecera_.num_trozos > maximo / sizeof(IndiceTrozo) || cabecera_.num_muestras > maximo / sizeof(float) ||
+            cabecera_.num_bins > maximo / (2 * sizeof(float)))
+            throw runtime_error("Caché incompleta");
+        uint64_t inicio_senal = sizeof(CabeceraCache) + cabecera_.num_trozos * sizeof(IndiceTrozo);
+        uint64_t inicio_espectro = inicio_senal + cabecera_.num_muestras * sizeof(float);
+        if (inicio_espectro + cabecera_.num_bins * 2 * sizeof(float) > maximo)
+            throw runtime_error("Caché incompleta");
+
+        indice_ = reinterpret_cast<const IndiceTrozo*>(archivo_.datos() + sizeof(CabeceraCache));
+        bins_ = reinterpret_cast<const float*>(archivo_.datos() + inicio_espectro);
+    }
+
+    bool coincide(uint64_t hash_contenido, uint64_t hash_parametros) const {
+        return cabecera_.hash_contenido == hash_contenido && cabecera_.hash_parametros == hash_parametros;
+    }
+
+    const CabeceraCache& cabecera() const { return cabecera_; }
+
+    SenalDecimada senal() const {
+        size_t primera;
+        return tramo({0.0, numeric_limits<double>::infinity()}, primera);
+    }
+
+    // Tramo [inicio, fin) s de la señal; primera es el índice de su primera muestra decimada
+    SenalDecimada tramo(const RangoTiempo& rango, size_t& primera) const {
+        SenalDecimada resultado;
+        resultado.frecuencia_muestreo = cabecera_.frecuencia_muestreo;
+        resultado.factor = cabecera_.factor;
+        primera = 0;
+        if (cabecera_.num_trozos == 0) return resultado;
+
+        // Trozo que contiene el inicio, por búsqueda binaria en el índice
+        const IndiceTrozo* fin_indice = indice_ + cabecera_.num_trozos;
+        const IndiceTrozo* trozo = upper_bound(indice_, fin_indice, rango.inicio,
+            [](double t, const IndiceTrozo& entrada) { return t < entrada.tiempo_inicio; });
+        if (trozo != indice_) --trozo;
+
+        double fs = cabecera_.frecuencia_muestreo;
+        size_t base = static_cast<size_t>(trozo - indice_) * cabecera_.muestras_por_trozo;
+        size_t desde = min<size_t>(cabecera_.num_muestras, max<size_t>(base, static_cast<size_t>(ceil(rango.inicio * fs))));
+        double fin = ceil(rango.fin * fs);
+        size_t hasta = fin >= cabecera_.num_muestras ? cabecera_.num_muestras : static_cast<size_t>(fin);
+
+        primera = desde;
+        if (hasta > desde) {
+            if (trozo->desplazamiento + (hasta - base) * sizeof(float) > archivo_.tamano())
+                throw runtime_error("Índice de caché inválido");
+            const float* datos = reinterpret_cast<const float*>(archivo_.datos() + trozo->desplazamiento) + (desde - base);
+            resultado.muestras.assign(datos, datos + (hasta - desde));
+        }
+        return resultado;
+    }
+
+    // Espectro filtrado completo (con la mitad negativa conjugada), vacío si no se guardó
+    vector<complex<double>> espectro() const {
+        vector<complex<double>> X;
+        if (cabecera_.num_bins == 0) return X;
+        size_t n = cabecera_.tamano_fft;
+        X.assign(n, complex<double>(0.0, 0.0));
+        for (size_t k = 0; k < cabecera_.num_bins; k++) {
+            size_t bin = cabecera_.bin_inicial + k;
+            X[bin] = complex<double>(bins_[2 * k], bins_[2 * k + 1]);
+            if (bin != 0 && bin != n / 2) X[n - bin] = conj(X[bin]);
+        }
+        return X;
+    }
+
+private:
+    ArchivoMapeado archivo_;
+    CabeceraCache cabecera_;
+    const IndiceTrozo* indice_ = nullptr;
+    const float* bins_ = nullptr;
+};
+
+/*
+Lee de la caché el tramo [inicio, fin) s de la señal si la caché existe y
+corresponde al audio y a los parámetros actuales. Solo se copian los trozos
+del rango, localizados con el índice; primera es el índice de la primera
+muestra decimada del tramo.
+*/
+bool leerCacheDecimada(const string& ruta, uint64_t hash_contenido, uint64_t hash_parametros,
+                       const RangoTiempo& rango, SenalDecimada& senal, size_t& primera) {
+    try {
+        CacheDecimada cache(ruta);
+        if (!cache.coincide(hash_contenido, hash_parametros)) return false;
+        senal = cache.tramo(rango, primera);
+        return true;
+    } catch (exception&) {
+        return false;   // caché ausente o inválida: se recalcula
+    }
+}
+
+bool leerCacheDecimada(const string& ruta, uint64_t hash_contenido, uint64_t hash_parametros, SenalDecimada& senal) {
+    size_t primera;
+    return leerCacheDecimada(ruta, hash_contenido, hash_parametros, {0.0, numeric_limits<double>::infinity()},
+                             senal, primera);
+}
+
+
+/*
+Escritor de la señal filtrada: WAV flotante de 32 bits con dos canales, la señal
+y una pista de marcas (1 en las muestras con pico, 0 en el resto). Se escribe por
+bloques a medida que el pipeline los produce; solo se guarda el bloque entrelazado.
+Si se conoce la longitud total se usa la escritura secuencial de dr_wav, que no
+vuelve atrás a reescribir la cabecera (sirve también para tuberías).
+
+WAV solo admite frecuencias enteras y la decimación por potencias de 2 da
+frecuencias como 44100 / 256 = 172.27 Hz. En ese caso la señal se remuestrea a
+la frecuencia entera más cercana por interpolación lineal entre bloques; la
+señal filtrada no tiene contenido por encima de unos pocos Hz, así que el error
+es despreciable, y cada pico se marca en la muestra de salida más cercana.
+*/
+class EscritorSenalFiltrada {
+public:
+    // total_cuadros (de la señal de entrada) = 0 si la longitud no se conoce de antemano
+    EscritorSenalFiltrada(const string& ruta, double frecuencia_muestreo, drwav_uint64 total_cuadros = 0)
+        : frecuencia_salida_(max(1.0, round(frecuencia_muestreo))),
+          paso_(frecuencia_muestreo / frecuencia_salida_),
+          remuestrear_(frecuencia_salida_ != frecuencia_muestreo) {
+        if (total_cuadros > 0)
+            total_ = remuestrear_ ? static_cast<drwav_uint64>(floor((total_cuadros - 1) / paso_)) + 1 : total_cuadros;
+
+        drwav_data_format formato;
+        formato.container = drwav_container_riff;
+        formato.format = DR_WAVE_FORMAT_IEEE_FLOAT;
+        formato.channels = 2;
+        formato.sampleRate = static_cast<drwav_uint32>(frecuencia_salida_);
+        formato.bitsPerSample = 32;
+
+        bool abierto = total_ > 0 ? drwav_init_file_write_sequential_pcm_frames(&wav_, ruta.c_str(), &formato, total_, NULL)
+                                  : drwav_init_file_write(&wav_, ruta.c_str(), &formato, NULL);
+        if (!abierto)
+            throw runtime_error("No se pudo crear el WAV de salida");
+        abierto_ = true;
+    }
+
+    ~EscritorSenalFiltrada() {
+        try {
+            cerrar();
+        } catch (...) {
+        }
+    }
+
+    EscritorSenalFiltrada(const EscritorSenalFiltrada&) = delete;
+    EscritorSenalFiltrada& operator=(const EscritorSenalFiltrada&) = delete;
+
+    double frecuenciaSalida() const { return frecuencia_salida_; }
+
+    // Escribe n muestras; picos son índices ordenados desde el inicio de la señal (pueden caer fuera del bloque)
+    void escribirBloque(const double* muestras, size_t n, const vector<size_t>& picos) {
+        if (!abierto_)
+            throw runtime_error("El WAV de salida ya está cerrado");
+        if (n == 0) return;
+
+        if (!remuestrear_) {
+            entrelazado_.resize(2 * n);
+            for (size_t i = 0; i < n; i++) {
+                entrelazado_[2 * i] = static_cast<float>(muestras[i]);
+                entrelazado_[2 * i + 1] = 0.0f;
+            }
+            auto pico = lower_bound(picos.begin(), picos.end(), static_cast<size_t>(escritos_));
+            for (; pico != picos.end() && *pico < escritos_ + n; ++pico)
+                entrelazado_[2 * (*pico - escritos_) + 1] = 1.0f;
+            escribirCuadros(n);
+            entradas_ += n;
+            return;
+        }
+
+        // La salida j cae en la posición j * paso_ de la entrada; se interpola entre sus dos vecinas,
+        // usando la última muestra del bloque anterior para la que queda entre bloques
+        drwav_uint64 fin_entrada = entradas_ + n;
+        entrelazado_.clear();
+        drwav_uint64 j = escritos_;
+        for (;; j++) {
+            double posicion = j * paso_;
+            drwav_uint64 izquierda = static_cast<drwav_uint64>(posicion);
+            if (izquierda >= fin_entrada || (izquierda + 1 >= fin_entrada && posicion > izquierda)) break;
+            double fraccion = posicion - izquierda;
+            double a = izquierda >= entradas_ ? muestras[izquierda - entradas_] : anterior_;
+            double b = fraccion > 0 ? muestras[izquierda + 1 - entradas_] : a;
+            entrelazado_.push_back(static_cast<float>(a + fraccion * (b - a)));
+            entrelazado_.push_back(0.0f);
+        }
+
+        // Picos llevados a la muestra de salida más cercana
+        size_t desde = escritos_ > 0 ? static_cast<size_t>((escritos_ - 1) * paso_) : 0;
+        for (auto pico = lower_bound(picos.begin(), picos.end(), desde); pico != picos.end(); ++pico) {
+            drwav_uint64 destino = static_cast<drwav_uint64>(llround(*pico / paso_));
+            if (destino >= j) break;
+            if (destino >= escritos_) entrelazado_[2 * (destino - escritos_) + 1] = 1.0f;
+        }
+
+        anterior_ = muestras[n - 1];
+        entradas_ = fin_entrada;
+        escribirCuadros(static_cast<size_t>(j - escritos_));
+    }
+
+    drwav_uint64 cuadrosEscritos() const { return escritos_; }
+
+    // En escritura secuencial, si faltan cuadros se completan con silencio para que la cabecera sea correcta
+    void cerrar() {
+        if (!abierto_) return;
+        while (escritos_ < total_) {
+            size_t n = static_cast<size_t>(min<drwav_uint64>(4096, total_ - escritos_));
+            entrelazado_.assign(2 * n, 0.0f);
+            escribirCuadros(n);
+        }
+        drwav_uninit(&wav_);
+        abierto_ = false;
+    }
+
+private:
+    void escribirCuadros(size_t n) {
+        if (total_ > 0 && escritos_ + n > total_)
+            throw runtime_error("Se escribieron más cuadros de los declarados");
+        if (n > 0 && drwav_write_pcm_frames(&wav_, n, entrelazado_.data()) != n)
+            throw runtime_error("No se pudo escribir el WAV de salida");
+        escritos_ += n;
+    }
+
+    drwav wav_;
+    double frecuencia_salida_;
+    double paso_;                   // muestras de entrada por muestra de salida
+    bool remuestrear_;
+    drwav_uint64 total_ = 0;
+    drwav_uint64 escritos_ = 0;     // cuadros de salida
+    drwav_uint64 entradas_ = 0;     // muestras de entrada recibidas
+    double anterior_ = 0.0;         // última muestra de entrada del bloque anterior
+    bool abierto_ = false;
+    vector<float> entrelazado_;
+};
+
+// Escribe una señal decimada con sus picos (en muestras de la señal original), bloque a bloque
+void escribirSenalFiltrada(const string& ruta, const SenalDecimada& senal, const vector<size_t>& picos_originales,
+                           size_t tam_bloque = 4096) {
+    vector<size_t> picos(picos_originales.size());
+    for (size_t i = 0; i < picos.size(); i++) picos[i] = picos_originales[i] / senal.factor;
+
+    EscritorSenalFiltrada escritor(ruta, senal.frecuencia_muestreo, senal.muestras.size());
+    for (size_t inicio = 0; inicio < senal.muestras.size(); inicio += tam_bloque) {
+        size_t n = min(tam_bloque, senal.muestras.size() - inicio);
+        escritor.escribirBloque(senal.muestras.data() + inicio, n, picos);
+    }
+    escritor.cerrar();
+}
+
+
+// Extracción de BPM
+/*
+Candidatos a pico en [desde, hasta): máximos locales estrictos por encima del umbral.
+Las comparaciones se evalúan sin saltos en bloques pequeños (el compilador las
+vectoriza) y solo se recorren las marcas para recoger los índices.
+*/
+void candidatosPicos(const vector<double>& senal, size_t desde, size_t hasta, double umbral_absoluto,
+                     vector<size_t>& candidatos) {
+    const size_t TAM_TESELA = 1024;
+    uint8_t marcas[TAM_TESELA];
+    const double* x = senal.data();
+
+    desde = max<size_t>(desde, 1);
+    hasta = min(hasta, senal.size() > 0 ? senal.size() - 1 : 0);
+    for (size_t inicio = desde; inicio < hasta; inicio += TAM_TESELA) {
+        size_t n = min(TAM_TESELA, hasta - inicio);
+        const double* centro = x + inicio;
+        for (size_t i = 0; i < n; i++) {
+            marcas[i] = static_cast<uint8_t>((centro[i] > umbral_absoluto) & (centro[i] > centro[i - 1]) &
+                                             (centro[i] > centro[i + 1]));
+        }
+        for (size_t i = 0; i < n; i++) {
+            if (marcas[i]) candidatos.push_back(inicio + i);
+        }
+    }
+}
+
+/*
+Supresión de no máximos: un candidato es pico si es el mayor de los candidatos a
+menos de 'distancia' muestras (en empate gana el primero), de modo que en cada
+periodo refractario queda el más alto y los picos quedan separados al menos
+'distancia'. Ventana deslizante con una cola monótona: O(número de candidatos).
+Solo se devuelven los picos en [desde, hasta), pero la ventana usa todos los candidatos.
+*/
+void suprimirNoMaximos(const vector<double>& senal, const vector<size_t>& candidatos, size_t distancia,
+                       size_t desde, size_t hasta, vector<size_t>& picos) {
+    vector<size_t> cola(candidatos.size());   // posiciones en candidatos, valores decrecientes
+    size_t frente = 0, fondo = 0;
+    size_t siguiente = 0;   // siguiente candidato por entrar en la ventana
+
+    for (size_t k = 0; k < candidatos.size(); k++) {
+        size_t i = candidatos[k];
+        while (siguiente < candidatos.size() && candidatos[siguiente] < i + distancia) {
+            double valor = senal[candidatos[siguiente]];
+            while (fondo > frente && senal[candidatos[cola[fondo - 1]]] < valor) fondo--;
+            cola[fondo++] = siguiente++;
+        }
+        while (candidatos[cola[frente]] + distancia <= i) frente++;
+
+        if (cola[frente] == k && i >= desde && i < hasta) picos.push_back(i);
+    }
+}
+
+/*
+Detección de picos por tramos en paralelo (hilos = 0 usa todos los núcleos).
+El máximo global se reduce entre hilos y cada tramo busca candidatos también en
+un margen de 'distancia' a cada lado, así que la supresión de no máximos ve en
+las costuras la misma ventana que en serie y el resultado es idéntico.
+*/
+vector<size_t> detectarPicos(const vector<double>& senal_filtrada, double umbral_picos, int distancia_minima_muestras,
+                             unsigned int hilos = 0) {
+    vector<size_t> indices_picos;
+    if (senal_filtrada.empty()) {
+        return indices_picos;
+    }
+    size_t n = senal_filtrada.size();
+    size_t distancia = static_cast<size_t>(max(distancia_minima_muestras, 1));
+
+    mutex candado;
+    double valor_maximo = senal_filtrada[0];
+    ejecutarEnParalelo(n, hilos, [&](size_t inicio, size_t fin) {
+        double maximo_local = *std::max_element(senal_filtrada.begin() + inicio, senal_filtrada.begin() + fin);
+        lock_guard<mutex> bloqueo(candado);
+        valor_maximo = max(valor_maximo, maximo_local);
+    });
+    double umbral_absoluto = valor_maximo * umbral_picos; 
+
+    // Picos de cada tramo, unidos después en orden de posición
+    vector<pair<size_t, vector<size_t>>> por_tramo;
+    ejecutarEnParalelo(n, hilos, [&](size_t inicio, size_t fin) {
+        size_t desde = inicio >= distancia ? inicio - distancia : 0;
+        size_t hasta = min(n, fin + distancia);
+        vector<size_t> candidatos, picos;
+        candidatosPicos(senal_filtrada, desde, hasta, umbral_absoluto, candidatos);
+        suprimirNoMaximos(senal_filtrada, candidatos, distancia, inicio, fin, picos);
+
+        lock_guard<mutex> bloqueo(candado);
+        por_tramo.emplace_back(inicio, move(picos));
+    });
+
+    sort(por_tramo.begin(), por_tramo.end());
+    for (const auto& tramo : por_tramo)
+        indices_picos.insert(indices_picos.end(), tramo.second.begin(), tramo.second.end());
+    return indices_picos;
+}
+
+// Potencia de la VFC en las bandas LF (0.04-0.15 Hz) y HF (0.15-0.4 Hz), en ms²
+struct PotenciaVFC {
+    bool valida = false;   // falsa si la serie RR es demasiado corta para la banda LF
+    double lf = 0.0;
+    double hf = 0.0;
+    double lf_hf = 0.0;
+};
+
+// Estructura para almacenar los resultados del BPM
+struct ResultadosBPM {
+    double bpm_promedio;
+    vector<double> intervalos_rr_segundos; 
+    vector<size_t> indices_picos;
+    vector<double> tiempos_picos_segundos;   // instante de cada pico con resolución menor que una muestra
+    double confianza = -1.0;   // en [0, 1] para los estimadores sin picos; -1 si no aplica
+    PotenciaVFC potencia_vfc;
+};
+
+void calcularIntervalosRR(ResultadosBPM& resultados, double frecuencia_muestreo);
+vector<double> interpolarPicos(const vector<double>& senal, const vector<size_t>& indices, double frecuencia_muestreo);
+PotenciaVFC potenciaVFC(const vector<double>& tiempos_latidos, const vector<double>& intervalos_rr);
+
+// 'hilos' es el número de hilos para detectar picos (0: uno por núcleo)
+ResultadosBPM extraerBPM(const vector<double>& senal_filtrada, double frecuencia_muestreo, double umbral_picos = 0.7,
+                         int distancia_minima_muestras = 0, unsigned int hilos = 0) {
+    ResultadosBPM resultados;
+    resultados.bpm_promedio = 0.0;
+    resultados.intervalos_rr_segundos.clear();
+    resultados.indices_picos.clear();
+
+    if (senal_filtrada.empty() || frecuencia_muestreo <= 0) {
+        return resultados;
+    }
+    // Calcular una distancia mínima
+    if (distancia_minima_muestras == 0) {
+        distancia_minima_muestras = static_cast<int>(0.2 * frecuencia_muestreo); // 0.2 segundos de "refractario" entre picos
+        if (distancia_minima_muestras < 1) distancia_minima_muestras = 1;
+    }
+
+    resultados.indices_picos = detectarPicos(senal_filtrada, umbral_picos, distancia_minima_muestras, hilos);
+    resultados.tiempos_picos_segundos = interpolarPicos(senal_filtrada, resultados.indices_picos, frecuencia_muestreo);
+    calcularIntervalosRR(resultados, frecuencia_muestreo);
+    return resultados;
+}
+
+/*
+Interpolación parabólica: se ajusta una parábola a la muestra del pico y sus dos
+vecinas y se toma su vértice. En una señal filtrada (suave frente a fs) el error
+es una fracción pequeña de muestra, lo que permite medir RR con precisión de
+milisegundos aun con la señal decimada a 50-100 Hz.
+*/
+double desplazamientoParabolico(double izquierda, double centro, double derecha) {
+    double curvatura = izquierda - 2 * centro + derecha;
+    return curvatura < 0 ? 0.5 * (izquierda - derecha) / curvatura : 0.0;
+}
+
+vector<double> interpolarPicos(const vector<double>& senal, const vector<size_t>& indices, double frecuencia_muestreo) {
+    vector<double> tiempos(indices.size());
+    for (size_t p = 0; p < indices.size(); p++) {
+        size_t i = indices[p];
+        double desplazamiento = 0.0;
+        if (i > 0 && i + 1 < senal.size()) desplazamiento = desplazamientoParabolico(senal[i - 1], senal[i], senal[i + 1]);
+        tiempos[p] = (i + desplazamiento) / frecuencia_muestreo;
+    }
+    return tiempos;
+}
+
+// Intervalos RR y BPM promedio a partir de los índices de los picos
+void calcularIntervalosRR(ResultadosBPM& resultados, double frecuencia_muestreo) {
+    resultados.intervalos_rr_segundos.clear();
+    resultados.bpm_promedio = 0.0;
+    if (resultados.indices_picos.size() < 2) {
+        return; // Minimo dos picos para calcular un intervalo
+    }
+
+    // Calcular los intervalos RR (con los instantes interpolados si los hay)
+    bool interpolados = resultados.tiempos_picos_segundos.size() == resultados.indices_picos.size();
+    for (size_t i = 0; i < resultados.indices_picos.size() - 1; ++i) {
+        double tiempo_entre_picos = interpolados ?
+            resultados.tiempos_picos_segundos[i+1] - resultados.tiempos_picos_segundos[i] :
+            (double)(resultados.indices_picos[i+1] - resultados.indices_picos[i]) / frecuencia_muestreo;
+        resultados.intervalos_rr_segundos.push_back(tiempo_entre_picos);
+    }
+
+    // Cada intervalo se ubica en el instante del latido que lo cierra
+    vector<double> tiempos_latidos(resultados.intervalos_rr_segundos.size());
+    for (size_t i = 0; i < tiempos_latidos.size(); ++i) {
+        tiempos_latidos[i] = interpolados ? resultados.tiempos_picos_segundos[i + 1]
+                                          : resultados.indices_picos[i + 1] / frecuencia_muestreo;
+    }
+    resultados.potencia_vfc = potenciaVFC(tiempos_latidos, resultados.intervalos_rr_segundos);
+
+    // Calcular BPM promedio
+    if (!resultados.intervalos_rr_segundos.empty()) {
+        double suma_intervalos = std::accumulate(resultados.intervalos_rr_segundos.begin(), resultados.intervalos_rr_segundos.end(), 0.0);
+        double promedio_intervalo_rr = suma_intervalos / resultados.intervalos_rr_segundos.size();
+
+        if (promedio_intervalo_rr > 0) {
+            resultados.bpm_promedio = 60.0 / promedio_intervalo_rr;
+        }
+    }
+}
+
+// Extrae el BPM de una señal decimada; los picos se devuelven en muestras de la señal original
+ResultadosBPM extraerBPMDecimada(const SenalDecimada& senal, double umbral_picos = 0.7, unsigned int hilos = 0) {
+    ResultadosBPM resultados = extraerBPM(senal.muestras, senal.frecuencia_muestreo, umbral_picos, 0, hilos);
+    for (size_t& indice : resultados.indices_picos) {
+        indice *= senal.factor;
+    }
+    return resultados;
+}
+
+// IFFT decimada de un espectro ya filtrado, recortada a la duración de la señal original (n muestras)
+SenalDecimada reconstruirFiltrada(const vector<complex<double>>& espectro, size_t n, double frecuencia_muestreo,
+                                  double fs_minima = 100.0) {
+    SenalDecimada senal_filtrada = ifft_real_decimada(espectro, frecuencia_muestreo, fs_minima);
+    senal_filtrada.muestras.resize((n + senal_filtrada.factor - 1) / senal_filtrada.factor);
+    return senal_filtrada;
+}
+
+// FFT, filtrado e IFFT decimada de una señal, recortada a su duración original
+SenalDecimada filtrarSenal(const vector<double>& senal, double frecuencia_muestreo, double fs_minima = 100.0) {
+    vector<complex<double>> espectro = obtenerEspectroParaFiltrado(senal);
+    filtrarFrecuencias(espectro, frecuencia_muestreo);
+    return reconstruirFiltrada(espectro, senal.size(), frecuencia_muestreo, fs_minima);
+}
+
+
+// Banda por defecto de los ruidos cardiacos (S1, S2) para la envolvente
+const double FRECUENCIA_ENVOLVENTE_MIN = 20.0;
+const double FRECUENCIA_ENVOLVENTE_MAX = 200.0;
+
+/*
+Envolvente de Hilbert a partir del espectro que ya calcula el pipeline (no hace
+otra FFT directa): se toman solo las frecuencias positivas de la banda, duplicadas,
+lo que da la señal analítica, y su módulo es la envolvente. El módulo no cambia al
+desplazar la banda en frecuencia, así que los bins se llevan a banda base y basta
+una IFFT del tamaño del ancho de banda (o de fs_minima), como en ifft_real_decimada.
+Con la banda del filtro da la envolvente de la señal filtrada; con la de los ruidos
+cardiacos da las ráfagas de energía de cada latido.
+*/
+SenalDecimada envolventeHilbert(const vector<complex<double>>& espectro, size_t n, double frecuencia_muestreo,
+                                double f_min = FRECUENCIA_ENVOLVENTE_MIN, double f_max = FRECUENCIA_ENVOLVENTE_MAX,
+                                double fs_minima = 100.0) {
+    size_t N = espectro.size();
+    if (N < 2 || (N & (N - 1)) != 0) {
+        throw runtime_error("La envolvente requiere un espectro de tamaño potencia de 2");
+    }
+
+    SenalDecimada envolvente;
+    size_t k_min = max<size_t>(1, static_cast<size_t>(ceil(f_min * N / frecuencia_muestreo)));
+    size_t k_max = min(N / 2 - 1, static_cast<size_t>(floor(f_max * N / frecuencia_muestreo)));
+    size_t ancho = k_max >= k_min ? k_max - k_min + 1 : 0;
+
+    size_t M = siguiente_potencia2(max<size_t>(ancho, static_cast<size_t>(ceil(fs_minima * N / frecuencia_muestreo))));
+    M = min(M, N);
+    vector<complex<double>> Y(M, complex<double>(0.0, 0.0));
+    for (size_t j = 0; j < ancho; j++) Y[j] = 2.0 * espectro[k_min + j];
+
+    vector<complex<double>> analitica = ifft(Y);
+    double escala = static_cast<double>(M) / N;   // ifft divide entre M en lugar de N
+    envolvente.factor = N / M;
+    envolvente.frecuencia_muestreo = frecuencia_muestreo / envolvente.factor;
+    envolvente.muestras.resize(min(M, (n + envolvente.factor - 1) / envolvente.factor));
+    for (size_t i = 0; i < envolvente.muestras.size(); i++) envolvente.muestras[i] = abs(analitica[i]) * escala;
+    return envolvente;
+}
+
+/*
+Envolvente en flujo: transformador de Hilbert FIR de longitud impar (coeficientes
+2/(pi k) en los k impares, con ventana de Hamming) y módulo con la muestra
+retrasada (longitud - 1) / 2. Procesa bloques de cualquier tamaño guardando solo
+las últimas longitud - 1 muestras; es fiel para frecuencias alejadas de 0 y de
+Nyquist, así que conviene aplicarlo a una señal ya filtrada en banda.
+*/
+class EnvolventeHilbertFIR {
+public:
+    explicit EnvolventeHilbertFIR(size_t longitud = 63) {
+        if (longitud < 3 || longitud % 2 == 0)
+            throw runtime_error("La longitud del Hilbert FIR debe ser impar y al menos 3");
+        retardo_ = (longitud - 1) / 2;
+        coeficientes_.assign(longitud, 0.0);
+        for (size_t i = 0; i < longitud; i++) {
+            long k = static_cast<long>(i) - static_cast<long>(retardo_);
+            if (k % 2 == 0) continue;
+            double ventana = 0.54 - 0.46 * cos(2 * PI * i / (longitud - 1));
+            coeficientes_[i] = 2.0 / (PI * k) * ventana;
+        }
+        historia_.assign(longitud - 1, 0.0);
+    }
+
+    // Añade a envolvente una salida por muestra de entrada; la salida i corresponde a la entrada i - retardo()
+    void procesarBloque(const double* muestras, size_t n, vector<double>& envolvente) {
+        size_t longitud = coeficientes_.size();
+        ventana_.resize(historia_.size() + n);
+        copy(historia_.begin(), historia_.end(), ventana_.begin());
+        copy(muestras, muestras + n, ventana_.begin() + historia_.size());
+
+        for (size_t i = 0; i < n; i++) {
+            const double* x = ventana_.data() + i;   // x[longitud - 1] es la muestra actual
+            double cuadratura = 0.0;
+            // Solo son no nulos los coeficientes con j - retardo impar
+            for (size_t j = (retardo_ + 1) % 2; j < longitud; j += 2) cuadratura += coeficientes_[j] * x[longitud - 1 - j];
+            double fase = x[longitud - 1 - retardo_];
+            envolvente.push_back(sqrt(fase * fase + cuadratura * cuadratura));
+        }
+        copy(ventana_.end() - historia_.size(), ventana_.end(), historia_.begin());
+    }
+
+    size_t retardo() const { return retardo_; }
+
+private:
+    vector<double> coeficientes_;
+    vector<double> historia_;
+    vector<double> ventana_;
+    size_t retardo_;
+};
+
+// Método con el que se obtiene el BPM
+enum class EstimadorBPM {
+    Picos,             // detección de picos sobre la señal filtrada (da también los intervalos RR)
+    Espectral,         // frecuencia dominante del espectro, sin IFFT
+    Autocorrelacion,   // periodo con mayor autocorrelación de la señal filtrada
+    Cepstral,          // quefrencia dominante del cepstro real, sin IFFT completa
+    Envolvente         // picos de la envolvente de Hilbert de los ruidos cardiacos
+};
+
+// Los estimadores espectral, cepstral y de envolvente trabajan sobre el espectro sin filtrar
+bool usaEspectroSinFiltrar(EstimadorBPM estimador) {
+    return estimador == EstimadorBPM::Espectral || estimador == EstimadorBPM::Cepstral ||
+           estimador == EstimadorBPM::Envolvente;
+}
+
+// BPM estimado sin detectar latidos individuales
+struct EstimacionBPM {
+    double bpm = 0.0;
+    double confianza = 0.0;   // en [0, 1]
+};
+
+/*
+Estimador espectral: busca la frecuencia fundamental dentro de la banda cardiaca
+con el producto espectral de armónicos (HPS), sumando el logaritmo de |X| en la
+fundamental y sus armónicos, lo que evita confundir la fundamental con un armónico
+más fuerte. La frecuencia se afina con interpolación cuadrática entre bins.
+Usa el espectro sin filtrar que da obtenerEspectroParaFiltrado (los armónicos
+quedan fuera de la banda del filtro). La confianza es la fracción de la energía,
+entre la banda y el último armónico, que cae en la fundamental y sus armónicos.
+*/
+EstimacionBPM estimarBPMEspectral(const vector<complex<double>>& espectro, double frecuencia_muestreo, size_t armonicos = 3) {
+    EstimacionBPM estimacion;
+    size_t n = espectro.size();
+    if (n < 4 || frecuencia_muestreo <= 0 || armonicos == 0) return estimacion;
+    BandaFiltro banda = bandaFiltro(n, frecuencia_muestreo);
+    if (banda.k_min > banda.k_max) return estimacion;
+
+    size_t k_limite = min(n / 2, armonicos * banda.k_max + armonicos);
+    vector<double> magnitud(k_limite + 1);
+    double maximo = 0.0;
+    for (size_t k = 0; k <= k_limite; k++) {
+        magnitud[k] = abs(espectro[k]);
+        maximo = max(maximo, magnitud[k]);
+    }
+    if (maximo == 0.0) return estimacion;
+    double piso = 1e-12 * maximo;   // evita log(0) en bins vacíos
+
+    // Armónico h de la fundamental k: máximo alrededor de h*k (el redondeo de k se amplifica por h)
+    auto armonico = [&](size_t k, size_t h) {
+        size_t centro = h * k, margen = h / 2;
+        double valor = 0.0;
+        for (size_t j = centro - min(centro, margen); j <= min(k_limite, centro + margen); j++) valor = max(valor, magnitud[j]);
+        return valor;
+    };
+
+    size_t mejor = banda.k_min;
+    double mejor_puntuacion = -numeric_limits<double>::infinity();
+    for (size_t k = max<size_t>(banda.k_min, 1); k <= banda.k_max; k++) {
+        double puntuacion = 0.0;
+        for (size_t h = 1; h <= armonicos && h * k <= k_limite; h++) puntuacion += log(armonico(k, h) + piso);
+        if (puntuacion > mejor_puntuacion) {
+            mejor_puntuacion = puntuacion;
+            mejor = k;
+        }
+    }
+
+    // Vértice de la parábola por los logaritmos de los bins vecinos
+    double desplazamiento = 0.0;
+    if (mejor > 0 && mejor < k_limite) {
+        double izquierda = log(magnitud[mejor - 1] + piso), centro = log(magnitud[mejor] + piso),
+               derecha = log(magnitud[mejor + 1] + piso);
+        double curvatura = izquierda - 2 * centro + derecha;
+        if (curvatura < 0) desplazamiento = max(-0.5, min(0.5, 0.5 * (izquierda - derecha) / curvatura));
+    }
+    double k_fundamental = mejor + desplazamiento;
+    estimacion.bpm = 60.0 * k_fundamental * frecuencia_muestreo / n;
+
+    double energia_total = 0.0, energia_armonicos = 0.0;
+    for (size_t k = banda.k_min; k <= k_limite; k++) energia_total += magnitud[k] * magnitud[k];
+    for (size_t h = 1; h <= armonicos; h++) {
+        size_t centro = static_cast<size_t>(llround(h * k_fundamental));
+        for (size_t k = centro - min<size_t>(centro, 1); k <= min(k_limite, centro + 1); k++) {
+            if (k >= banda.k_min) energia_armonicos += magnitud[k] * magnitud[k];
+        }
+    }
+    estimacion.confianza = energia_total > 0 ? min(1.0, energia_armonicos / energia_total) : 0.0;
+    return estimacion;
+}
+
+/*
+Autocorrelación por Wiener-Khinchin: FFT de la señal sin media (con ceros hasta
+el doble de largo para que no se solape circularmente), |X|^2 e IFFT. Es una sola
+pasada O(N log N) y usa las tablas de giros en caché de planFFT. Devuelve los
+retardos 0..max_retardo sin normalizar.
+*/
+vector<double> autocorrelacion(const vector<double>& senal, size_t max_retardo) {
+    size_t n = senal.size();
+    if (n == 0) return {};
+    double media = accumulate(senal.begin(), senal.end(), 0.0) / n;
+
+    vector<complex<double>> x(siguiente_potencia2(2 * n), complex<double>(0.0, 0.0));
+    for (size_t i = 0; i < n; i++) x[i] = senal[i] - media;
+    vector<complex<double>> X = fft(x);
+    for (auto& valor : X) valor = norm(valor);
+
+    vector<double> r = ifft_real(X);
+    r.resize(min(max_retardo, n - 1) + 1);
+    return r;
+}
+
+/*
+Estimador por autocorrelación: el periodo cardiaco es el retardo, entre
+retardo_min y retardo_max segundos, con el máximo local más alto de la
+autocorrelación, afinado por interpolación parabólica. Tolera murmullos y
+ruidos S1/S2 desdoblados porque compara la señal completa consigo misma en vez
+de depender de picos aislados. La confianza es la autocorrelación normalizada
+(sin sesgo por la longitud) en ese retardo. Pensado para la señal decimada.
+*/
+EstimacionBPM estimarBPMAutocorrelacion(const vector<double>& senal, double frecuencia_muestreo,
+                                        double retardo_min = 0.2, double retardo_max = 2.0) {
+    EstimacionBPM estimacion;
+    if (senal.size() < 3 || frecuencia_muestreo <= 0) return estimacion;
+
+    size_t desde = max<size_t>(1, static_cast<size_t>(ceil(retardo_min * frecuencia_muestreo)));
+    size_t hasta = static_cast<size_t>(floor(retardo_max * frecuencia_muestreo));
+    vector<double> r = autocorrelacion(senal, hasta + 1);
+    if (r.empty() || r[0] <= 0) return estimacion;
+    hasta = min(hasta, r.size() - 2);
+
+    size_t mejor = 0;
+    for (size_t k = max<size_t>(desde, 1); k <= hasta; k++) {
+        if (r[k] > r[k - 1] && r[k] >= r[k + 1] && (mejor == 0 || r[k] > r[mejor])) mejor = k;
+    }
+    if (mejor == 0) return estimacion;
+
+    double desplazamiento = 0.0;
+    double curvatura = r[mejor - 1] - 2 * r[mejor] + r[mejor + 1];
+    if (curvatura < 0) desplazamiento = 0.5 * (r[mejor - 1] - r[mejor + 1]) / curvatura;
+    estimacion.bpm = 60.0 * frecuencia_muestreo / (mejor + desplazamiento);
+
+    double n = static_cast<double>(senal.size());
+    estimacion.confianza = max(0.0, min(1.0, r[mejor] / r[0] * n / (n - mejor)));
+    return estimacion;
+}
+
+/*
+Cepstro real: IFFT del logaritmo de |X|. Un latido periódico deja en el espectro
+armónicos separados f0, que en el cepstro forman un pico en la quefrencia 1/f0.
+Como con la IFFT decimada, solo se usan los bins hasta fs_minima / 2: la
+transformada es mucho más pequeña y la quefrencia queda con resolución de
+1 / fs_minima segundos, que se afina con interpolación parabólica. Se busca el
+máximo local más alto entre 0.2 y 2 s; la confianza es la fracción de la norma
+del cepstro en ese rango que aporta el pico.
+*/
+EstimacionBPM estimarBPMCepstral(const vector<complex<double>>& espectro, double frecuencia_muestreo,
+                                 double fs_minima = 100.0, double quefrencia_min = 0.2, double quefrencia_max = 2.0) {
+    EstimacionBPM estimacion;
+    size_t n = espectro.size();
+    if (n < 4 || (n & (n - 1)) != 0 || frecuencia_muestreo <= 0) return estimacion;
+
+    size_t m = min(n, siguiente_potencia2(static_cast<size_t>(ceil(fs_minima * n / frecuencia_muestreo))));
+    m = max<size_t>(m, 4);
+    double maximo = 0.0;
+    for (size_t k = 0; k <= m / 2; k++) maximo = max(maximo, abs(espectro[k]));
+    if (maximo == 0.0) return estimacion;
+    double piso = 1e-9 * maximo;   // evita log(0) en bins vacíos
+
+    // Log-magnitud simétrica (real y par), así el cepstro es real
+    vector<complex<double>> log_magnitud(m);
+    for (size_t k = 0; k <= m / 2; k++) {
+        log_magnitud[k] = log(abs(espectro[k]) + piso);
+        if (k != 0 && k != m / 2) log_magnitud[m - k] = log_magnitud[k];
+    }
+    vector<double> cepstro = ifft_real(log_magnitud);
+
+    double fs_cepstro = m * frecuencia_muestreo / n;   // muestras de quefrencia por segundo
+    size_t desde = max<size_t>(1, static_cast<size_t>(ceil(quefrencia_min * fs_cepstro)));
+    size_t hasta = min(m / 2 - 1, static_cast<size_t>(floor(quefrencia_max * fs_cepstro)));
+    if (desde > hasta) return estimacion;
+
+    size_t mejor = 0;
+    double energia = 0.0;
+    for (size_t q = desde; q <= hasta; q++) {
+        energia += cepstro[q] * cepstro[q];
+        if (cepstro[q] > cepstro[q - 1] && cepstro[q] >= cepstro[q + 1] && (mejor == 0 || cepstro[q] > cepstro[mejor]))
+            mejor = q;
+    }
+    if (mejor == 0 || cepstro[mejor] <= 0) return estimacion;
+
+    double desplazamiento = 0.0;
+    double curvatura = cepstro[mejor - 1] - 2 * cepstro[mejor] + cepstro[mejor + 1];
+    if (curvatura < 0) desplazamiento = 0.5 * (cepstro[mejor - 1] - cepstro[mejor + 1]) / curvatura;
+    estimacion.bpm = 60.0 * fs_cepstro / (mejor + desplazamiento);
+    estimacion.confianza = min(1.0, cepstro[mejor] / sqrt(energia));
+    return estimacion;
+}
+
+// Cepstro de una señal por ventanas de 'ventana' segundos cada 'salto' segundos, en paralelo
+vector<EstimacionBPM> estimarBPMCepstralVentanas(const vector<double>& senal, double frecuencia_muestreo,
+                                                 double ventana = 10.0, double salto = 5.0, double fs_minima = 100.0) {
+    size_t largo = static_cast<size_t>(ventana * frecuencia_muestreo);
+    size_t paso = static_cast<size_t>(salto * frecuencia_muestreo);
+    if (largo == 0 || paso == 0 || senal.size() < largo) return {};
+
+    vector<EstimacionBPM> estimaciones((senal.size() - largo) / paso + 1);
+    ejecutarEnParalelo(estimaciones.size(), 0, [&](size_t inicio, size_t fin) {
+        for (size_t w = inicio; w < fin; w++) {
+            vector<double> tramo(senal.begin() + w * paso, senal.begin() + w * paso + largo);
+            estimaciones[w] = estimarBPMCepstral(obtenerEspectroParaFiltrado(tramo), frecuencia_muestreo, fs_minima);
+        }
+    }, 1);
+    return estimaciones;
+}
+
+// Resultados con solo el BPM promedio y la confianza de un estimador sin picos
+ResultadosBPM resultadosDeEstimacion(const EstimacionBPM& estimacion) {
+    ResultadosBPM resultados;
+    resultados.bpm_promedio = estimacion.bpm;
+    resultados.confianza = estimacion.confianza;
+    return resultados;
+}
+
+/*
+BPM sobre la envolvente de los ruidos cardiacos: cada latido es una ráfaga de
+energía, así que la envolvente tiene un máximo por ráfaga en lugar de uno por
+oscilación. La envolvente (ya decimada) pasa por el filtro cardiaco y la
+detección de picos; los picos se devuelven en muestras de la señal original.
+*/
+ResultadosBPM extraerBPMEnvolvente(const vector<complex<double>>& espectro, size_t n, double frecuencia_muestreo,
+                                   double umbral_picos = 0.7, unsigned int hilos = 0) {
+    SenalDecimada envolvente = envolventeHilbert(espectro, n, frecuencia_muestreo);
+
+    // Se centra antes del filtro: la envolvente es positiva y el relleno con ceros crearía un escalón en los bordes
+    if (!envolvente.muestras.empty()) {
+        double media = accumulate(envolvente.muestras.begin(), envolvente.muestras.end(), 0.0) / envolvente.muestras.size();
+        for (double& v : envolvente.muestras) v -= media;
+    }
+    ResultadosBPM resultados =
+        extraerBPMDecimada(filtrarSenal(envolvente.muestras, envolvente.frecuencia_muestreo), umbral_picos, hilos);
+    for (size_t& indice : resultados.indices_picos) indice *= envolvente.factor;
+    return resultados;
+}
+
+// BPM de un estimador que trabaja sobre el espectro sin filtrar (n = muestras de la señal original)
+ResultadosBPM estimarBPMEspectro(const vector<complex<double>>& espectro, double frecuencia_muestreo, EstimadorBPM estimador,
+                                 size_t n, double umbral_picos = 0.7, unsigned int hilos = 0) {
+    if (estimador == EstimadorBPM::Envolvente)
+        return extraerBPMEnvolvente(espectro, n, frecuencia_muestreo, umbral_picos, hilos);
+    return resultadosDeEstimacion(estimador == EstimadorBPM::Cepstral ? estimarBPMCepstral(espectro, frecuencia_muestreo)
+                                                                      : estimarBPMEspectral(espectro, frecuencia_muestreo));
+}
+
+// BPM de una señal filtrada y decimada con un estimador que trabaja en el dominio del tiempo
+ResultadosBPM estimarBPMDecimada(const SenalDecimada& senal, double umbral_picos = 0.7,
+                                 EstimadorBPM estimador = EstimadorBPM::Picos, unsigned int hilos = 0) {
+    switch (estimador) {
+        case EstimadorBPM::Picos:
+            return extraerBPMDecimada(senal, umbral_picos, hilos);
+        case EstimadorBPM::Autocorrelacion:
+            return resultadosDeEstimacion(estimarBPMAutocorrelacion(senal.muestras, senal.frecuencia_muestreo));
+        default:
+            throw runtime_error("El estimador elegido necesita el espectro sin filtrar");
+    }
+}
+
+/*
+Detector de picos en línea (al estilo Pan-Tompkins): en lugar de un umbral fijo
+relativo al máximo global, sigue un nivel de señal y otro de ruido con medias
+exponenciales y usa un umbral entre ambos. Consume la señal por bloques y emite
+cada pico con un retraso máximo de un periodo refractario (el candidato más alto
+dentro de ese periodo es el que queda); al inicio acumula un periodo de
+aprendizaje para fijar los niveles. Un artefacto aislado solo sube el nivel de
+señal de forma transitoria, así que no anula los latidos siguientes.
+*/
+class DetectorPicosEnLinea {
+public:
+    // umbral: posición del umbral entre el nivel de ruido (0) y el de señal (1)
+    DetectorPicosEnLinea(double frecuencia_muestreo, double umbral = 0.25, double refractario_segundos = 0.2,
+                         double aprendizaje_segundos = 2.0)
+        : umbral_(umbral),
+          refractario_(max<size_t>(1, static_cast<size_t>(refractario_segundos * frecuencia_muestreo))),
+          aprendizaje_(max<size_t>(1, static_cast<size_t>(aprendizaje_segundos * frecuencia_muestreo))) {
+        if (!(frecuencia_muestreo > 0))
+            throw runtime_error("La frecuencia de muestreo debe ser positiva");
+        buffer_aprendizaje_.reserve(aprendizaje_);
+    }
+
+    // Procesa un bloque y añade a picos los que quedan confirmados (índices desde el inicio de la señal)
+    void procesarBloque(const double* muestras, size_t n, vector<size_t>& picos) {
+        for (size_t i = 0; i < n; i++) {
+            if (!iniciado_) {
+                buffer_aprendizaje_.push_back(muestras[i]);
+                if (buffer_aprendizaje_.size() == aprendizaje_) terminarAprendizaje(picos);
+            } else {
+                procesarMuestra(muestras[i], picos);
+            }
+        }
+    }
+
+    // Fin de la señal: emite lo que quede pendiente
+    void finalizar(vector<size_t>& picos) {
+        if (!iniciado_) terminarAprendizaje(picos);
+        if (hay_pendiente_) confirmarPendiente(picos);
+    }
+
+    double nivelSenal() const { return nivel_senal_; }
+    double nivelRuido() const { return nivel_ruido_; }
+
+private:
+    // Niveles iniciales a partir del periodo de aprendizaje, que luego se procesa normalmente
+    void terminarAprendizaje(vector<size_t>& picos) {
+        iniciado_ = true;
+        if (buffer_aprendizaje_.empty()) return;
+
+        double maximo = buffer_aprendizaje_[0];
+        double suma_absoluta = 0.0;
+        for (double x : buffer_aprendizaje_) {
+            maximo = max(maximo, x);
+            suma_absoluta += abs(x);
+        }
+        nivel_senal_ = maximo;
+        nivel_ruido_ = 0.5 * suma_absoluta / buffer_aprendizaje_.size();
+
+        for (double x : buffer_aprendizaje_) procesarMuestra(x, picos);
+        buffer_aprendizaje_.clear();
+        buffer_aprendizaje_.shrink_to_fit();
+    }
+
+    void procesarMuestra(double x, vector<size_t>& picos) {
+        size_t i = indice_++;
+
+        // El pendiente se confirma cuando termina su periodo refractario
+        if (hay_pendiente_ && i - pendiente_ >= refractario_) confirmarPendiente(picos);
+
+        // x[i-1] es candidato si es máximo local estricto
+        if (i >= 2 && anterior_ > anterior2_ && anterior_ > x) evaluarCandidato(i - 1, anterior_);
+        anterior2_ = anterior_;
+        anterior_ = x;
+    }
+
+    void evaluarCandidato(size_t indice, double valor) {
+        double umbral = nivel_ruido_ + umbral_ * (nivel_senal_ - nivel_ruido_);
+        if (valor <= umbral) {
+            nivel_ruido_ = 0.125 * valor + 0.875 * nivel_ruido_;
+            return;
+        }
+        if (hay_pendiente_ && indice - pendiente_ < refractario_) {
+            // Dentro del periodo refractario gana el más alto
+            if (valor > valor_pendiente_) {
+                pendiente_ = indice;
+                valor_pendiente_ = valor;
+            }
+            return;
+        }
+        if (hay_ultimo_ && indice - ultimo_ < refractario_) return;
+
+        pendiente_ = indice;
+        valor_pendiente_ = valor;
+        hay_pendiente_ = true;
+    }
+
+    void confirmarPendiente(vector<size_t>& picos) {
+        picos.push_back(pendiente_);
+        nivel_senal_ = 0.125 * valor_pendiente_ + 0.875 * nivel_senal_;
+        ultimo_ = pendiente_;
+        hay_ultimo_ = true;
+        hay_pendiente_ = false;
+    }
+
+    double umbral_;
+    size_t refractario_;
+    size_t aprendizaje_;
+    vector<double> buffer_aprendizaje_;
+    bool iniciado_ = false;
+
+    double nivel_senal_ = 0.0;
+    double nivel_ruido_ = 0.0;
+    size_t indice_ = 0;
+    double anterior_ = 0.0;
+    double anterior2_ = 0.0;
+
+    bool hay_pendiente_ = false;
+    size_t pendiente_ = 0;
+    double valor_pendiente_ = 0.0;
+    bool hay_ultimo_ = false;
+    size_t ultimo_ = 0;
+};
+
+// BPM con el detector en línea, alimentado por bloques como lo haría un flujo
+ResultadosBPM extraerBPMEnLinea(const vector<double>& senal_filtrada, double frecuencia_muestreo, size_t tam_bloque = 4096) {
+    ResultadosBPM resultados;
+    resultados.bpm_promedio = 0.0;
+    if (senal_filtrada.empty() || frecuencia_muestreo <= 0) return resultados;
+
+    DetectorPicosEnLinea detector(frecuencia_muestreo);
+    for (size_t inicio = 0; inicio < senal_filtrada.size(); inicio += tam_bloque) {
+        size_t n = min(tam_bloque, senal_filtrada.size() - inicio);
+        detector.procesarBloque(senal_filtrada.data() + inicio, n, resultados.indices_picos);
+    }
+    detector.finalizar(resultados.indices_picos);
+    resultados.tiempos_picos_segundos = interpolarPicos(senal_filtrada, resultados.indices_picos, frecuencia_muestreo);
+    calcularIntervalosRR(resultados, frecuencia_muestreo);
+    return resultados;
+}
+
+// Un punto de la serie temporal de BPM
+struct PuntoSerieBPM {
+    double tiempo_segundos;   // final de la ventana
+    double bpm;               // 0 si la ventana tiene menos de dos latidos
+    size_t latidos;
+};
+
+/*
+Serie de BPM por ventanas deslizantes (por ejemplo 10 s cada 1 s). Los latidos
+entran en orden y salen por el frente de la cola al quedar fuera de la ventana,
+así que cada latido se procesa una vez. El BPM de la ventana es 60 / RR medio, y
+el RR medio de k latidos es (último - primero) / (k - 1) porque la suma de los
+intervalos se telescopa: cada punto cuesta O(1) más los latidos que entran y salen.
+*/
+class SerieBPMDeslizante {
+public:
+    SerieBPMDeslizante(double ventana_segundos = 10.0, double paso_segundos = 1.0, double inicio_segundos = 0.0)
+        : inicio_(inicio_segundos), ventana_(ventana_segundos), paso_(paso_segundos) {
+        if (!(ventana_ > 0) || !(paso_ > 0))
+            throw runtime_error("La ventana y el paso de la serie deben ser positivos");
+    }
+
+    // Los latidos deben llegar en orden y después de avanzar el reloj hasta su instante
+    void agregarLatido(double tiempo) {
+        latidos_.push_back(tiempo);
+    }
+
+    // Emite un punto por cada final de ventana hasta 'tiempo' inclusive
+    void avanzarHasta(double tiempo, vector<PuntoSerieBPM>& serie) {
+        for (double fin = finSiguiente(); fin <= tiempo; fin = finSiguiente()) {
+            while (!latidos_.empty() && latidos_.front() < fin - ventana_) latidos_.pop_front();
+
+            PuntoSerieBPM punto = {fin, 0.0, latidos_.size()};
+            if (latidos_.size() >= 2 && latidos_.back() > latidos_.front())
+                punto.bpm = 60.0 * (latidos_.size() - 1) / (latidos_.back() - latidos_.front());
+            serie.push_back(punto);
+            pasos_++;
+        }
+    }
+
+private:
+    // Se calcula desde el inicio para no acumular error de redondeo al sumar pasos
+    double finSiguiente() const { return inicio_ + ventana_ + pasos_ * paso_; }
+
+    double inicio_;
+    double ventana_;
+    double paso_;
+    size_t pasos_ = 0;
+    deque<double> latidos_;
+};
+
+// Serie de BPM a partir de los instantes de los picos de una señal que dura [inicio, fin) s
+vector<PuntoSerieBPM> serieBPM(const vector<double>& tiempos_picos, double inicio, double fin,
+                               double ventana = 10.0, double paso = 1.0) {
+    vector<PuntoSerieBPM> serie;
+    SerieBPMDeslizante deslizante(ventana, paso, inicio);
+    for (double tiempo : tiempos_picos) {
+        deslizante.avanzarHasta(tiempo, serie);
+        deslizante.agregarLatido(tiempo);
+    }
+    deslizante.avanzarHasta(fin, serie);
+    return serie;
+}
+
+/*
+Serie de BPM en línea: la señal filtrada entra por bloques al detector en línea
+y los latidos pasan a la serie deslizante. Cada bloque cierra las ventanas que
+ya no pueden recibir picos (el detector confirma con un retraso de hasta un
+periodo refractario). Para interpolar el instante de cada pico solo se guardan
+las últimas muestras que el detector aún puede confirmar (el aprendizaje y un
+periodo refractario), así que la memoria no crece con la duración del flujo.
+*/
+class SerieBPMEnLinea {
+public:
+    SerieBPMEnLinea(double frecuencia_muestreo, double inicio_segundos = 0.0, double ventana = 10.0, double paso = 1.0,
+                    double refractario = 0.2, double aprendizaje = 2.0)
+        : frecuencia_muestreo_(frecuencia_muestreo), inicio_(inicio_segundos), refractario_(refractario),
+          detector_(frecuencia_muestreo, 0.25, refractario, aprendizaje), deslizante_(ventana, paso, inicio_segundos),
+          conservar_(static_cast<size_t>((aprendizaje + refractario) * frecuencia_muestreo) + 2) {}
+
+    // Procesa un bloque de la señal filtrada y añade a serie las ventanas que quedan cerradas
+    void procesarBloque(const double* muestras, size_t n, vector<PuntoSerieBPM>& serie) {
+        historia_.insert(historia_.end(), muestras, muestras + n);
+        picos_.clear();
+        detector_.procesarBloque(muestras, n, picos_);
+        agregarPicos(serie);
+        procesadas_ += n;
+        deslizante_.avanzarHasta(inicio_ + procesadas_ / frecuencia_muestreo_ - refractario_, serie);
+
+        if (historia_.size() > conservar_) {
+            size_t sobrantes = historia_.size() - conservar_;
+            historia_.erase(historia_.begin(), historia_.begin() + sobrantes);
+            primera_ += sobrantes;
+        }
+    }
+
+    // Fin de la señal: confirma el último pico y cierra las ventanas restantes
+    void finalizar(vector<PuntoSerieBPM>& serie) {
+        picos_.clear();
+        detector_.finalizar(picos_);
+        agregarPicos(serie);
+        deslizante_.avanzarHasta(inicio_ + procesadas_ / frecuencia_muestreo_, serie);
+    }
+
+private:
+    void agregarPicos(vector<PuntoSerieBPM>& serie) {
+        for (size_t i : picos_) {
+            double desplazamiento = 0.0;
+            if (i > primera_ && i + 1 < primera_ + historia_.size()) {
+                size_t k = i - primera_;
+                desplazamiento = desplazamientoParabolico(historia_[k - 1], historia_[k], historia_[k + 1]);
+            }
+            double tiempo = inicio_ + (i + desplazamiento) / frecuencia_muestreo_;
+            deslizante_.avanzarHasta(tiempo, serie);
+            deslizante_.agregarLatido(tiempo);
+        }
+    }
+
+    double frecuencia_muestreo_;
+    double inicio_;
+    double refractario_;
+    DetectorPicosEnLinea detector_;
+    SerieBPMDeslizante deslizante_;
+    size_t conservar_;
+    deque<double> historia_;   // muestras [primera_, primera_ + historia_.size())
+    size_t primera_ = 0;
+    size_t procesadas_ = 0;
+    vector<size_t> picos_;
+};
+
+// Serie de BPM en línea de una señal ya filtrada, alimentada por bloques de 'paso' segundos
+vector<PuntoSerieBPM> serieBPMEnLinea(const vector<double>& senal_filtrada, double frecuencia_muestreo,
+                                      double ventana = 10.0, double paso = 1.0, double refractario = 0.2) {
+    vector<PuntoSerieBPM> serie;
+    if (senal_filtrada.empty() || frecuencia_muestreo <= 0) return serie;
+
+    SerieBPMEnLinea en_linea(frecuencia_muestreo, 0.0, ventana, paso, refractario);
+    size_t tam_bloque = max<size_t>(1, static_cast<size_t>(paso * frecuencia_muestreo));
+    for (size_t inicio = 0; inicio < senal_filtrada.size(); inicio += tam_bloque)
+        en_linea.procesarBloque(senal_filtrada.data() + inicio, min(tam_bloque, senal_filtrada.size() - inicio), serie);
+    en_linea.finalizar(serie);
+    return serie;
+}
+
+// Sección IIR de segundo orden (forma directa II traspuesta), con los coeficientes de Butterworth
+class FiltroBiquad {
+public:
+    static FiltroBiquad pasoBajo(double corte, double frecuencia_muestreo) {
+        return FiltroBiquad(corte, frecuencia_muestreo, false);
+    }
+    static FiltroBiquad pasoAlto(double corte, double frecuencia_muestreo) {
+        return FiltroBiquad(corte, frecuencia_muestreo, true);
+    }
+
+    double procesar(double x) {
+        double y = b0_ * x + z1_;
+        z1_ = b1_ * x - a1_ * y + z2_;
+        z2_ = b2_ * x - a2_ * y;
+        return y;
+    }
+
+private:
+    FiltroBiquad(double corte, double frecuencia_muestreo, bool paso_alto) {
+        if (!(corte > 0) || !(corte < frecuencia_muestreo / 2))
+            throw runtime_error("La frecuencia de corte debe estar entre 0 y Nyquist");
+        double w0 = 2 * PI * corte / frecuencia_muestreo;
+        double alfa = sin(w0) / (2 * sqrt(0.5)), coseno = cos(w0);
+        double a0 = 1 + alfa;
+        double lado = (paso_alto ? 1 + coseno : 1 - coseno) / 2;
+        b0_ = lado / a0;
+        b1_ = (paso_alto ? -2 * lado : 2 * lado) / a0;
+        b2_ = lado / a0;
+        a1_ = -2 * coseno / a0;
+        a2_ = (1 - alfa) / a0;
+    }
+
+    double b0_, b1_, b2_, a1_, a2_;
+    double z1_ = 0.0, z2_ = 0.0;
+};
+
+/*
+Serie de BPM de un flujo de audio sin filtrar, calculada bloque a bloque a medida
+que llega. El filtro por FFT del resto del pipeline necesita la señal completa,
+así que aquí se promedian grupos de muestras para bajar a fs_minima o algo más
+(la banda cardiaca queda muy por debajo, de modo que el promedio basta como
+antialias), se filtra con un paso alto y un paso bajo de Butterworth en los bordes
+de la banda del filtro y el resultado alimenta a SerieBPMEnLinea.
+*/
+class SerieBPMEnFlujo {
+public:
+    SerieBPMEnFlujo(double frecuencia_muestreo, double inicio_segundos = 0.0, double ventana = 10.0, double paso = 1.0,
+                    double fs_minima = 100.0)
+        : factor_(max<size_t>(1, static_cast<size_t>(frecuencia_muestreo / fs_minima))),
+          paso_alto_(FiltroBiquad::pasoAlto(FRECUENCIA_FILTRO_MIN, frecuencia_muestreo / factor_)),
+          paso_bajo_(FiltroBiquad::pasoBajo(FRECUENCIA_FILTRO_MAX, frecuencia_muestreo / factor_)),
+          en_linea_(frecuencia_muestreo / factor_, inicio_segundos, ventana, paso) {}
+
+    // Procesa un bloque de audio y añade a serie las ventanas que quedan cerradas
+    void procesarBloque(const double* muestras, size_t n, vector<PuntoSerieBPM>& serie) {
+        filtradas_.clear();
+        for (size_t i = 0; i < n; i++) {
+            suma_ += muestras[i];
+            if (++acumuladas_ < factor_) continue;
+            filtradas_.push_back(paso_bajo_.procesar(paso_alto_.procesar(suma_ / factor_)));
+            suma_ = 0.0;
+            acumuladas_ = 0;
+        }
+        en_linea_.procesarBloque(filtradas_.data(), filtradas_.size(), serie);
+    }
+
+    void finalizar(vector<PuntoSerieBPM>& serie) { en_linea_.finalizar(serie); }
+
+private:
+    size_t factor_;
+    FiltroBiquad paso_alto_;
+    FiltroBiquad paso_bajo_;
+    SerieBPMEnLinea en_linea_;
+    double suma_ = 0.0;
+    size_t acumuladas_ = 0;
+    vector<double> filtradas_;
+};
+
+// Pipeline completo para una señal: FFT, filtrado, IFFT decimada y extracción de BPM
+// (el estimador espectral se queda en el espectro y no hace la IFFT; si se pasa 'filtrada', recibe la señal filtrada)
+ResultadosBPM analizarSenal(const vector<double>& senal, double frecuencia_muestreo, double umbral_picos = 0.7,
+                            EstimadorBPM estimador = EstimadorBPM::Picos, unsigned int hilos = 0,
+                            SenalDecimada* filtrada = nullptr) {
+    vector<complex<double>> espectro = obtenerEspectroParaFiltrado(senal);
+    if (usaEspectroSinFiltrar(estimador))
+        return estimarBPMEspectro(espectro, frecuencia_muestreo, estimador, senal.size(), umbral_picos, hilos);
+
+    filtrarFrecuencias(espectro, frecuencia_muestreo);
+    SenalDecimada reconstruida = reconstruirFiltrada(espectro, senal.size(), frecuencia_muestreo);
+    ResultadosBPM resultados = estimarBPMDecimada(reconstruida, umbral_picos, estimador, hilos);
+    if (filtrada) *filtrada = move(reconstruida);
+    return resultados;
+}
+
+// Resultados de un audio multicanal
+struct ResultadosMulticanal {
+    vector<ResultadosBPM> por_canal;
+    double bpm_consenso = 0.0;   // mediana de los canales con BPM válido
+    size_t canal_representativo = 0;   // canal cuyo BPM está más cerca del consenso
+    SenalDecimada senal_representativa;   // señal filtrada de ese canal (vacía si el estimador usa el espectro sin filtrar)
+};
+
+// Analiza cada canal en su propio hilo y combina los BPM en un consenso
+ResultadosMulticanal analizarCanales(const vector<vector<double>>& canales, double frecuencia_muestreo, double umbral_picos = 0.7,
+                                     EstimadorBPM estimador = EstimadorBPM::Picos) {
+    ResultadosMulticanal resultados;
+    resultados.por_canal.resize(canales.size());
+    vector<exception_ptr> errores(canales.size());
+    vector<SenalDecimada> filtradas(canales.size());
+
+    // Ya hay un hilo por canal: los núcleos se reparten entre ellos para no crear canales x núcleos hilos
+    unsigned int nucleos = max(1u, thread::hardware_concurrency());
+    unsigned int hilos_por_canal = max<unsigned int>(1, nucleos / static_cast<unsigned int>(max<size_t>(1, canales.size())));
+    vector<thread> hilos;
+    for (size_t c = 0; c < canales.size(); c++) {
+        hilos.emplace_back([&, c]() {
+            try {
+                resultados.por_canal[c] =
+                    analizarSenal(canales[c], frecuencia_muestreo, umbral_picos, estimador, hilos_por_canal, &filtradas[c]);
+            } catch (...) {
+                errores[c] = current_exception();
+            }
+        });
+    }
+    for (auto& hilo : hilos) hilo.join();
+    for (auto& error : errores) {
+        if (error) rethrow_exception(error);
+    }
+
+    vector<double> bpms;
+    for (const auto& r : resultados.por_canal) {
+        if (r.bpm_promedio > 0) bpms.push_back(r.bpm_promedio);
+    }
+    if (!bpms.empty()) {
+        sort(bpms.begin(), bpms.end());
+        size_t mitad = bpms.size() / 2;
+        resultados.bpm_consenso = (bpms.size() % 2 == 1) ? bpms[mitad] : (bpms[mitad - 1] + bpms[mitad]) / 2.0;
+
+        double menor_distancia = -1.0;
+        for (size_t c = 0; c < resultados.por_canal.size(); c++) {
+            double distancia = abs(resultados.por_canal[c].bpm_promedio - resultados.bpm_consenso);
+            if (resultados.por_canal[c].bpm_promedio > 0 && (menor_distancia < 0 || distancia < menor_distancia)) {
+                menor_distancia = distancia;
+                resultados.canal_representativo = c;
+            }
+        }
+    }
+    if (!filtradas.empty()) resultados.senal_representativa = move(filtradas[resultados.canal_representativo]);
+    return resultados;
+}
+
+// Variabilidad de la frecuencia cardíaca (VFC) de un conjunto de intervalos RR
+struct MetricasVFC {
+    size_t intervalos = 0;
+    double rr_medio = 0.0;   // segundos
+    double sdnn = 0.0;       // desviación estándar de los RR (segundos)
+    double rmssd = 0.0;      // raíz del cuadrado medio de las diferencias sucesivas (segundos)
+    double pnn50 = 0.0;      // fracción de diferencias sucesivas mayores que 50 ms
+    double rr_min = 0.0;
+    double rr_max = 0.0;
+};
+
+/*
+VFC sobre una ventana deslizante de intervalos RR. Cada intervalo nuevo entra en
+O(1) y los que quedan fuera de la ventana (por duración acumulada) salen por el
+frente en O(1) amortizado:
+  - media y SDNN con Welford, que también admite quitar un valor;
+  - RMSSD y pNN50 con la suma de cuadrados y la cuenta de diferencias sucesivas,
+    de las que al retirar un intervalo solo cambia la primera;
+  - mínimo y máximo con colas monótonas.
+Con ventana infinita acumula toda la grabación.
+*/
+class VFCDeslizante {
+public:
+    explicit VFCDeslizante(double ventana_segundos = numeric_limits<double>::infinity())
+        : ventana_(ventana_segundos) {
+        if (!(ventana_ > 0)) throw runtime_error("La ventana de VFC debe ser positiva");
+    }
+
+    // Agrega el instante de un latido; a partir del segundo se obtiene un intervalo
+    void agregarLatido(double tiempo) {
+        if (hay_latido_) agregarIntervalo(tiempo - ultimo_latido_);
+        ultimo_latido_ = tiempo;
+        hay_latido_ = true;
+    }
+
+    void agregarIntervalo(double rr) {
+        if (!rr_.empty()) agregarDiferencia(rr - rr_.back(), +1);
+        rr_.push_back(rr);
+        duracion_ += rr;
+        numero_++;
+
+        double delta = rr - media_;
+        media_ += delta / rr_.size();
+        m2_ += delta * (rr - media_);
+
+        while (!minimos_.empty() && minimos_.back().second >= rr) minimos_.pop_back();
+        minimos_.emplace_back(numero_, rr);
+        while (!maximos_.empty() && maximos_.back().second <= rr) maximos_.pop_back();
+        maximos_.emplace_back(numero_, rr);
+
+        // La ventana conserva siempre el intervalo más reciente
+        while (rr_.size() > 1 && duracion_ > ventana_) retirarPrimero();
+    }
+
+    MetricasVFC metricas() const {
+        MetricasVFC m;
+        m.intervalos = rr_.size();
+        if (rr_.empty()) return m;
+        m.rr_medio = media_;
+        m.sdnn = sqrt(max(0.0, m2_) / rr_.size());
+        size_t diferencias = rr_.size() - 1;
+        if (diferencias > 0) {
+            m.rmssd = sqrt(max(0.0, suma_cuadrados_) / diferencias);
+            m.pnn50 = static_cast<double>(mayores_50ms_) / diferencias;
+        }
+        m.rr_min = minimos_.front().second;
+        m.rr_max = maximos_.front().second;
+        return m;
+    }
+
+private:
+    void agregarDiferencia(double diferencia, int signo) {
+        suma_cuadrados_ += signo * diferencia * diferencia;
+        if (abs(diferencia) > 0.05) mayores_50ms_ += signo;
+    }
+
+    void retirarPrimero() {
+        double rr = rr_.front();
+        agregarDiferencia(rr_[1] - rr, -1);
+        rr_.pop_front();
+        duracion_ -= rr;
+
+        double media_anterior = media_;
+        media_ -= (rr - media_) / rr_.size();
+        m2_ -= (rr - media_anterior) * (rr - media_);
+
+        size_t numero_primero = numero_ - rr_.size();
+        if (minimos_.front().first == numero_primero) minimos_.pop_front();
+        if (maximos_.front().first == numero_primero) maximos_.pop_front();
+    }
+
+    double ventana_;
+    deque<double> rr_;
+    double duracion_ = 0.0;
+    size_t numero_ = 0;               // intervalos agregados en total (numera los de las colas)
+    double media_ = 0.0;
+    double m2_ = 0.0;                 // suma de cuadrados de las desviaciones (Welford)
+    double suma_cuadrados_ = 0.0;     // de las diferencias sucesivas
+    long mayores_50ms_ = 0;
+    deque<pair<size_t, double>> minimos_;
+    deque<pair<size_t, double>> maximos_;
+    double ultimo_latido_ = 0.0;
+    bool hay_latido_ = false;
+};
+
+// VFC de todos los intervalos RR
+MetricasVFC calcularVFC(const vector<double>& intervalos_rr) {
+    VFCDeslizante vfc;
+    for (double rr : intervalos_rr) vfc.agregarIntervalo(rr);
+    return vfc.metricas();
+}
+
+// Un punto de la serie temporal de VFC: las métricas de la ventana que termina en un latido
+struct PuntoSerieVFC {
+    double tiempo_segundos;
+    MetricasVFC metricas;
+};
+
+// VFC en ventanas de 'ventana' segundos que terminan en cada latido (desde el segundo)
+vector<PuntoSerieVFC> serieVFC(const vector<double>& tiempos_picos, double ventana = 30.0) {
+    vector<PuntoSerieVFC> serie;
+    VFCDeslizante vfc(ventana);
+    for (size_t i = 0; i < tiempos_picos.size(); i++) {
+        vfc.agregarLatido(tiempos_picos[i]);
+        if (i > 0) serie.push_back({tiempos_picos[i], vfc.metricas()});
+    }
+    return serie;
+}
+
+// Bandas de la VFC en frecuencia (Hz)
+const double BANDA_LF_MIN = 0.04;
+const double BANDA_LF_MAX = 0.15;
+const double BANDA_HF_MAX = 0.4;
+const double DURACION_MINIMA_VFC = 2.0 / BANDA_LF_MIN;   // dos periodos de la frecuencia LF más baja
+
+// Periodograma de Lomb-Scargle de una serie muestreada en instantes irregulares
+struct PeriodogramaLomb {
+    double paso_frecuencia = 0.0;   // Hz; la frecuencia k es (k + 1) * paso_frecuencia
+    vector<double> densidad;        // densidad espectral (unidades de y al cuadrado por Hz)
+};
+
+// Densidad de Lomb-Scargle a partir de las sumas trigonométricas de una frecuencia:
+// C y S de h = y - media, C2 y S2 de cos/sin(2wt). 'periodo_medio' escala a unidades/Hz
+static double densidadLomb(double c, double s, double c2, double s2, size_t n, double periodo_medio) {
+    double hipotenusa = max(hypot(c2, s2), 1e-300);
+    double coseno_2wt = 0.5 * c2 / hipotenusa;
+    double seno_2wt = 0.5 * s2 / hipotenusa;
+    double coseno_wt = sqrt(0.5 + coseno_2wt);
+    double seno_wt = copysign(sqrt(max(0.0, 0.5 - coseno_2wt)), seno_2wt);
+    double denominador = 0.5 * n + coseno_2wt * c2 + seno_2wt * s2;   // suma de cos²(w(t - tau))
+    double termino_coseno = pow(coseno_wt * c + seno_wt * s, 2) / max(denominador, 1e-300);
+    double termino_seno = pow(coseno_wt * s - seno_wt * c, 2) / max(n - denominador, 1e-300);
+    return periodo_medio * (termino_coseno + termino_seno);
+}
+
+// Lomb-Scargle directo, O(N·F): referencia para las pruebas
+PeriodogramaLomb lombScargleDirecto(const vector<double>& t, const vector<double>& y, double frecuencia_maxima,
+                                    double sobremuestreo = 4.0) {
+    PeriodogramaLomb resultado;
+    size_t n = t.size();
+    if (n < 3 || t.back() <= t.front()) return resultado;
+    double duracion = t.back() - t.front();
+    double media = accumulate(y.begin(), y.end(), 0.0) / n;
+    resultado.paso_frecuencia = 1.0 / (sobremuestreo * duracion);
+    size_t frecuencias = static_cast<size_t>(frecuencia_maxima / resultado.paso_frecuencia);
+    resultado.densidad.resize(frecuencias);
+    for (size_t k = 0; k < frecuencias; k++) {
+        double w = 2 * PI * (k + 1) * resultado.paso_frecuencia;
+        double c = 0, s = 0, c2 = 0, s2 = 0;
+        for (size_t j = 0; j < n; j++) {
+            double fase = w * (t[j] - t.front());
+            c += (y[j] - media) * cos(fase);
+            s += (y[j] - media) * sin(fase);
+            c2 += cos(2 * fase);
+            s2 += sin(2 * fase);
+        }
+        resultado.densidad[k] = densidadLomb(c, s, c2, s2, n, duracion / n);
+    }
+    return resultado;
+}
+
+// Reparte 'valor' sobre los 'orden' puntos de la malla (periódica) más cercanos a la
+// posición x con pesos de Lagrange, de modo que sum valor * exp(i w x) se conserva
+// para las frecuencias bajas frente al tamaño de la malla
+static void extirpolar(double valor, double x, vector<double>& malla, int orden) {
+    long n = static_cast<long>(malla.size());
+    long primero = static_cast<long>(floor(x)) - (orden - 1) / 2;
+    for (int j = 0; j < orden; j++) {
+        double peso = 1.0;
+        for (int l = 0; l < orden; l++)
+            if (l != j) peso *= (x - (primero + l)) / static_cast<double>(j - l);
+        malla[((primero + j) % n + n) % n] += valor * peso;
+    }
+}
+
+/*
+Lomb-Scargle rápido (Press y Rybicki, 1989). Las sumas trigonométricas de todas
+las frecuencias k * df son la transformada de Fourier de los datos si cada
+muestra cae en la malla: se "extirpolan" h = y - media en la posición
+(t - t0) * df * N y un 1 en el doble de esa posición sobre mallas de N puntos, y
+dos FFT dan C, S, C2 y S2 a la vez. Cuesta O(N log N) en lugar de O(N·F).
+*/
+PeriodogramaLomb lombScargleRapido(const vector<double>& t, const vector<double>& y, double frecuencia_maxima,
+                                   double sobremuestreo = 4.0) {
+    const int orden = 4;   // puntos de la malla por muestra
+    PeriodogramaLomb resultado;
+    size_t n = t.size();
+    if (n < 3 || t.back() <= t.front()) return resultado;
+    double duracion = t.back() - t.front();
+    double media = accumulate(y.begin(), y.end(), 0.0) / n;
+    resultado.paso_frecuencia = 1.0 / (sobremuestreo * duracion);
+    size_t frecuencias = static_cast<size_t>(frecuencia_maxima / resultado.paso_frecuencia);
+    resultado.densidad.resize(frecuencias);
+    if (frecuencias == 0) return resultado;
+
+    // La malla debe ser holgada frente a la frecuencia más alta para que la extirpolación sea exacta
+    size_t N = siguiente_potencia2(4 * orden * (frecuencias + 1));
+    vector<double> malla_datos(N, 0.0), malla_doble(N, 0.0);
+    double escala = resultado.paso_frecuencia * N;
+    for (size_t j = 0; j < n; j++) {
+        double x = (t[j] - t.front()) * escala;
+        extirpolar(y[j] - media, x, malla_datos, orden);
+        extirpolar(1.0, fmod(2 * x, static_cast<double>(N)), malla_doble, orden);
+    }
+
+    // La FFT usa exp(-i w x): la parte real da C y la imaginaria cambiada de signo da S
+    vector<complex<double>> datos = fft_real(malla_datos);
+    vector<complex<double>> doble = fft_real(malla_doble);
+    for (size_t k = 0; k < frecuencias; k++) {
+        complex<double> suma = datos[k + 1];
+        complex<double> suma_doble = doble[k + 1];   // en la malla doble, el bin k es la frecuencia 2k
+        resultado.densidad[k] = densidadLomb(suma.real(), -suma.imag(), suma_doble.real(), -suma_doble.imag(), n,
+                                             duracion / n);
+    }
+    return resultado;
+}
+
+// Potencia (integral de la densidad) de un periodograma en [desde, hasta)
+double potenciaBanda(const PeriodogramaLomb& periodograma, double desde, double hasta) {
+    double potencia = 0.0;
+    for (size_t k = 0; k < periodograma.densidad.size(); k++) {
+        double f = (k + 1) * periodograma.paso_frecuencia;
+        if (f >= desde && f < hasta) potencia += periodograma.densidad[k];
+    }
+    return potencia * periodograma.paso_frecuencia;
+}
+
+// LF y HF de una serie RR (segundos) ubicada en los instantes de sus latidos
+PotenciaVFC potenciaVFC(const vector<double>& tiempos_latidos, const vector<double>& intervalos_rr) {
+    PotenciaVFC potencia;
+    if (tiempos_latidos.size() < 3 || tiempos_latidos.back() - tiempos_latidos.front() < DURACION_MINIMA_VFC)
+        return potencia;
+
+    PeriodogramaLomb periodograma = lombScargleRapido(tiempos_latidos, intervalos_rr, BANDA_HF_MAX + 0.01);
+    potencia.valida = true;
+    potencia.lf = potenciaBanda(periodograma, BANDA_LF_MIN, BANDA_LF_MAX) * 1e6;
+    potencia.hf = potenciaBanda(periodograma, BANDA_LF_MAX, BANDA_HF_MAX) * 1e6;
+    potencia.lf_hf = potencia.hf > 0 ? potencia.lf / potencia.hf : 0.0;
+    return potencia;
+}
+
+// Un punto de la serie de LF/HF: la ventana que termina en 'tiempo_segundos'
+struct PuntoSerieLFHF {
+    double tiempo_segundos;
+    PotenciaVFC potencia;
+};
+
+/*
+LF y HF sobre una ventana deslizante de la serie RR, actualizadas por latido.
+Las sumas de Lomb-Scargle se separan en acumuladores que no dependen de la media
+de la ventana (sum y cos(wt), sum y sin(wt), sum cos(wt), sum sin(wt), sum cos(2wt),
+sum sin(2wt)), con el instante medido desde un origen fijo y una malla de
+frecuencias fija de paso 1 / (sobremuestreo * ventana). Cada latido que entra o
+sale suma o resta su término en O(F), con exp(i k w0 t) por recurrencia, y la
+potencia de la ventana se obtiene en O(F) sin recalcular el periodograma.
+*/
+class PotenciaVFCDeslizante {
+public:
+    explicit PotenciaVFCDeslizante(double ventana_segundos = 120.0, double sobremuestreo = 4.0)
+        : paso_frecuencia_(1.0 / (sobremuestreo * ventana_segundos)) {
+        if (!(ventana_segundos > 0) || !(sobremuestreo > 0))
+            throw runtime_error("La ventana y el sobremuestreo de LF/HF deben ser positivos");
+        size_t frecuencias = static_cast<size_t>(BANDA_HF_MAX / paso_frecuencia_) + 1;
+        for (auto* suma : {&y_cos_, &y_sen_, &cos_, &sen_, &cos_doble_, &sen_doble_}) suma->assign(frecuencias, 0.0);
+    }
+
+    // Agrega un intervalo RR (segundos) ubicado en el instante del latido que lo cierra
+    void agregar(double tiempo, double rr) {
+        if (!hay_origen_) {
+            origen_ = tiempo;
+            hay_origen_ = true;
+        }
+        muestras_.emplace_back(tiempo, rr);
+        acumular(tiempo, rr, +1.0);
+    }
+
+    // Retira los intervalos anteriores a 'tiempo'
+    void retirarAntesDe(double tiempo) {
+        while (!muestras_.empty() && muestras_.front().first < tiempo) {
+            acumular(muestras_.front().first, muestras_.front().second, -1.0);
+            muestras_.pop_front();
+        }
+    }
+
+    PotenciaVFC potencia() const {
+        PotenciaVFC potencia;
+        size_t n = muestras_.size();
+        if (n < 3) return potencia;
+        double duracion = muestras_.back().first - muestras_.front().first;
+        if (duracion < DURACION_MINIMA_VFC) return potencia;
+
+        double media = suma_y_ / n;
+        for (size_t k = 0; k < cos_.size(); k++) {
+            double f = (k + 1) * paso_frecuencia_;
+            if (f < BANDA_LF_MIN || f >= BANDA_HF_MAX) continue;
+            double densidad = densidadLomb(y_cos_[k] - media * cos_[k], y_sen_[k] - media * sen_[k], cos_doble_[k],
+                                           sen_doble_[k], n, duracion / n);
+            (f < BANDA_LF_MAX ? potencia.lf : potencia.hf) += densidad * paso_frecuencia_ * 1e6;
+        }
+        potencia.valida = true;
+        potencia.lf_hf = potencia.hf > 0 ? potencia.lf / potencia.hf : 0.0;
+        return potencia;
+    }
+
+private:
+    void acumular(double tiempo, double rr, double signo) {
+        suma_y_ += signo * rr;
+        complex<double> giro = polar(1.0, 2 * PI * paso_frecuencia_ * (tiempo - origen_));
+        complex<double> fase = giro;   // exp(i w_k t) con w_k = (k + 1) w0
+        for (size_t k = 0; k < cos_.size(); k++) {
+            complex<double> doble = fase * fase;
+            y_cos_[k] += signo * rr * fase.real();
+            y_sen_[k] += signo * rr * fase.imag();
+            cos_[k] += signo * fase.real();
+            sen_[k] += signo * fase.imag();
+            cos_doble_[k] += signo * doble.real();
+            sen_doble_[k] += signo * doble.imag();
+            fase *= giro;
+        }
+    }
+
+    double paso_frecuencia_;
+    deque<pair<double, double>> muestras_;   // (instante, RR)
+    double origen_ = 0.0;
+    bool hay_origen_ = false;
+    double suma_y_ = 0.0;
+    vector<double> y_cos_, y_sen_, cos_, sen_, cos_doble_, sen_doble_;
+};
+
+// LF y HF en ventanas de 'ventana' segundos que avanzan de a 'paso'; cada latido
+// entra y sale una sola vez del acumulador deslizante
+vector<PuntoSerieLFHF> serieLFHF(const vector<double>& tiempos_picos, double ventana = 120.0, double paso = 30.0) {
+    vector<PuntoSerieLFHF> serie;
+    if (tiempos_picos.size() < 2 || !(ventana > 0) || !(paso > 0)) return serie;
+
+    PotenciaVFCDeslizante deslizante(ventana);
+    size_t siguiente = 1;
+    for (double fin = tiempos_picos.front() + ventana; fin <= tiempos_picos.back(); fin += paso) {
+        for (; siguiente < tiempos_picos.size() && tiempos_picos[siguiente] < fin; siguiente++)
+            deslizante.agregar(tiempos_picos[siguiente], tiempos_picos[siguiente] - tiempos_picos[siguiente - 1]);
+        deslizante.retirarAntesDe(fin - ventana);
+        serie.push_back({fin, deslizante.potencia()});
+    }
+    return serie;
+}
+
+// Detección de anomalias
+
+// Códigos de alerta; cada uno ocupa un bit del resultado
+enum class CodigoAlerta : uint8_t { DatosInsuficientes, Bradicardia, Taquicardia, Irregularidad, Cantidad };
+const size_t NUM_CODIGOS_ALERTA = static_cast<size_t>(CodigoAlerta::Cantidad);
+
+// Métricas sobre las que se evalúan las reglas
+enum class MetricaRegla : uint8_t { BPM, SDNN, RMSSD, PNN50, LF_HF, Cantidad };
+
+struct MetricasAnomalias {
+    double bpm = 0.0;
+    MetricasVFC vfc;
+    PotenciaVFC potencia;   // las reglas sobre LF/HF no se disparan si no es válida
+};
+
+// Una regla: la alerta 'codigo' se activa si la métrica supera (o no alcanza) el umbral
+struct ReglaAnomalia {
+    CodigoAlerta codigo;
+    MetricaRegla metrica;
+    bool mayor;   // true: metrica > umbral; false: metrica < umbral
+    double umbral;
+    const char* texto = nullptr;   // texto fijo del informe; si falta se arma con la condición
+};
+
+const size_t MAX_REGLAS_ANOMALIAS = 16;
+
+// Alertas activas en una evaluación y el instante de la ventana evaluada
+struct ResultadoAlertas {
+    bitset<NUM_CODIGOS_ALERTA> codigos;
+    bitset<MAX_REGLAS_ANOMALIAS> reglas;   // reglas que se dispararon, para el informe
+    double tiempo_segundos = 0.0;
+
+    bool tiene(CodigoAlerta codigo) const { return codigos.test(static_cast<size_t>(codigo)); }
+};
+
+// Nombres para los archivos de reglas y textos para los informes, indexados por el enum
+const char* const NOMBRES_CODIGOS[NUM_CODIGOS_ALERTA] = {"insuficiente", "bradicardia", "taquicardia", "irregularidad"};
+const char* const TEXTOS_CODIGOS[NUM_CODIGOS_ALERTA] = {
+    "No se puede evaluar anomalías (datos insuficientes)", "Bradicardia detectada", "Taquicardia detectada",
+    "Latido irregular"};
+const char* const NOMBRES_METRICAS[static_cast<size_t>(MetricaRegla::Cantidad)] = {"bpm", "sdnn", "rmssd", "pnn50",
+                                                                                   "lf_hf"};
+const char* const TEXTOS_METRICAS[static_cast<size_t>(MetricaRegla::Cantidad)] = {"BPM", "SDNN", "RMSSD", "pNN50",
+                                                                                  "LF/HF"};
+const char* const UNIDADES_METRICAS[static_cast<size_t>(MetricaRegla::Cantidad)] = {"", " s", " s", "", ""};
+
+// Valor de una métrica, o NaN (ninguna regla se dispara) si no hay datos para calcularla:
+// los estimadores sin picos dan el BPM pero no intervalos RR
+double valorMetrica(const MetricasAnomalias& metricas, MetricaRegla metrica) {
+    const double sin_datos = numeric_limits<double>::quiet_NaN();
+    switch (metrica) {
+        case MetricaRegla::BPM:   return metricas.bpm;
+        case MetricaRegla::SDNN:  return metricas.vfc.intervalos > 0 ? metricas.vfc.sdnn : sin_datos;
+        case MetricaRegla::RMSSD: return metricas.vfc.intervalos > 1 ? metricas.vfc.rmssd : sin_datos;
+        case MetricaRegla::PNN50: return metricas.vfc.intervalos > 1 ? metricas.vfc.pnn50 : sin_datos;
+        case MetricaRegla::LF_HF:
+            return metricas.potencia.valida ? metricas.potencia.lf_hf : numeric_limits<double>::quiet_NaN();
+        default:                  return numeric_limits<double>::quiet_NaN();
+    }
+}
+
+/*
+Motor de reglas de anomalías. Las reglas y umbrales se cargan una vez (por
+defecto o desde un archivo) en una tabla de tamaño fijo; evaluar() recorre la
+tabla sobre las métricas ya calculadas y devuelve un bitset de códigos, sin
+reservar memoria ni construir textos. Los textos se arman solo al informar.
+*/
+class MotorReglas {
+public:
+    static const size_t MAX_REGLAS = MAX_REGLAS_ANOMALIAS;
+
+    // Reglas por defecto: bradicardia < 60 bpm, taquicardia > 100 bpm, SDNN > 100 ms
+    MotorReglas() {
+        agregar({CodigoAlerta::Bradicardia, MetricaRegla::BPM, false, 60.0, "Bradicardia detectada (BPM < 60)"});
+        agregar({CodigoAlerta::Taquicardia, MetricaRegla::BPM, true, 100.0, "Taquicardia detectada (BPM > 100)"});
+        agregar({CodigoAlerta::Irregularidad, MetricaRegla::SDNN, true, 0.10, "Latido irregular (SDNN > 0.10s)"});
+    }
+
+    /*
+    Archivo de reglas: una por línea con la forma "codigo metrica < umbral" o
+    "codigo metrica > umbral" (por ejemplo "bradicardia bpm < 50"); '#' inicia un
+    comentario. Reemplaza las reglas por defecto.
+    */
+    static MotorReglas desdeArchivo(const string& ruta) {
+        ifstream archivo(ruta);
+        if (!archivo) throw runtime_error("No se puede abrir el archivo de reglas " + ruta);
+        MotorReglas motor;
+        motor.cantidad_ = 0;
+        string linea;
+        for (size_t numero = 1; getline(archivo, linea); numero++) {
+            linea = linea.substr(0, linea.find('#'));
+            istringstream campos(linea);
+            string codigo, metrica, comparacion, sobrante;
+            double umbral;
+            if (!(campos >> codigo)) continue;   // línea vacía
+            ReglaAnomalia regla;
+            if (!(campos >> metrica >> comparacion >> umbral) || (campos >> sobrante) ||
+                !buscarNombre(NOMBRES_CODIGOS, NUM_CODIGOS_ALERTA, codigo, regla.codigo) ||
+                regla.codigo == CodigoAlerta::DatosInsuficientes ||
+                !buscarNombre(NOMBRES_METRICAS, static_cast<size_t>(MetricaRegla::Cantidad), metrica, regla.metrica) ||
+                (comparacion != "<" && comparacion != ">"))
+                throw runtime_error("Regla inválida en la línea " + to_string(numero) + " de " + ruta);
+            regla.mayor = comparacion == ">";
+            regla.umbral = umbral;
+            motor.agregar(regla);
+        }
+        return motor;
+    }
+
+    void agregar(const ReglaAnomalia& regla) {
+        if (cantidad_ == MAX_REGLAS) throw runtime_error("Demasiadas reglas de anomalías");
+        reglas_[cantidad_++] = regla;
+    }
+
+    ResultadoAlertas evaluar(const MetricasAnomalias& metricas, double tiempo_segundos = 0.0) const noexcept {
+        ResultadoAlertas resultado;
+        resultado.tiempo_segundos = tiempo_segundos;
+        if (!(metricas.bpm > 0)) {
+            resultado.codigos.set(static_cast<size_t>(CodigoAlerta::DatosInsuficientes));
+            return resultado;
+        }
+        for (size_t r = 0; r < cantidad_; r++) {
+            const ReglaAnomalia& regla = reglas_[r];
+            double valor = valorMetrica(metricas, regla.metrica);
+            if (regla.mayor ? valor > regla.umbral : valor < regla.umbral) {
+                resultado.codigos.set(static_cast<size_t>(regla.codigo));
+                resultado.reglas.set(r);
+            }
+        }
+        return resultado;
+    }
+
+    // Un texto por regla disparada: el fijo de las reglas por defecto o, para las
+    // cargadas de un archivo, el de su código con la condición que la disparó
+    vector<string> describir(const ResultadoAlertas& resultado) const {
+        vector<string> textos;
+        if (resultado.tiene(CodigoAlerta::DatosInsuficientes))
+            textos.push_back(TEXTOS_CODIGOS[static_cast<size_t>(CodigoAlerta::DatosInsuficientes)]);
+        for (size_t r = 0; r < cantidad_; r++) {
+            if (!resultado.reglas.test(r)) continue;
+            const ReglaAnomalia& regla = reglas_[r];
+            if (regla.texto) {
+                textos.push_back(regla.texto);
+                continue;
+            }
+            ostringstream texto;
+            texto << TEXTOS_CODIGOS[static_cast<size_t>(regla.codigo)] << " ("
+                  << TEXTOS_METRICAS[static_cast<size_t>(regla.metrica)] << (regla.mayor ? " > " : " < ")
+                  << regla.umbral << UNIDADES_METRICAS[static_cast<size_t>(regla.metrica)] << ")";
+            textos.push_back(texto.str());
+        }
+        if (textos.empty()) textos.push_back("No se detectaron anomalías.");
+        return textos;
+    }
+
+    size_t cantidad() const { return cantidad_; }
+
+private:
+    template <typename Enum>
+    static bool buscarNombre(const char* const* nombres, size_t cantidad, const string& nombre, Enum& valor) {
+        for (size_t i = 0; i < cantidad; i++) {
+            if (nombre == nombres[i]) {
+                valor = static_cast<Enum>(i);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    array<ReglaAnomalia, MAX_REGLAS> reglas_;
+    size_t cantidad_ = 0;
+};
+
+// Reglas por defecto, compartidas por quienes no cargan otras
+const MotorReglas& reglasPorDefecto() {
+    static const MotorReglas motor;
+    return motor;
+}
+
+// Resultado de anomalías ya traducido a texto, para los informes
+struct Anomalias
+{
+    bool bradicardia = false;
+    bool taquicardia = false;
+    bool irregularidad = false;
+    vector<string> lista_alertas;
+};
+
+Anomalias describirAnomalias(const ResultadoAlertas& resultado, const MotorReglas& reglas = reglasPorDefecto())
+{
+    Anomalias a;
+    a.bradicardia = resultado.tiene(CodigoAlerta::Bradicardia);
+    a.taquicardia = resultado.tiene(CodigoAlerta::Taquicardia);
+    a.irregularidad = resultado.tiene(CodigoAlerta::Irregularidad);
+    a.lista_alertas = reglas.describir(resultado);
+    return a;
+}
+
+// Reglas sobre el BPM y la VFC; sirven tanto para una grabación completa como
+// para la ventana actual de un flujo en vivo
+Anomalias detectarAnomalias(double bpm, const MetricasVFC& vfc, const MotorReglas& reglas = reglasPorDefecto())
+{
+    MetricasAnomalias metricas;
+    metricas.bpm = bpm;
+    metricas.vfc = vfc;
+    return describirAnomalias(reglas.evaluar(metricas), reglas);
+}
+
+Anomalias detectarAnomalias(const ResultadosBPM &datos, const MotorReglas& reglas = reglasPorDefecto())
+{
+    MetricasAnomalias metricas;
+    metricas.bpm = datos.bpm_promedio;
+    metricas.vfc = calcularVFC(datos.intervalos_rr_segundos);
+    metricas.potencia = datos.potencia_vfc;
+    return describirAnomalias(reglas.evaluar(metricas), reglas);
+}
+
+// Escribe un WAV de 16 bits para las pruebas (muestras entrelazadas si hay varios canales)
+void escribirWavPrueba(const char* ruta, const vector<int16_t>& muestras, unsigned int fs, unsigned int canales = 1) {
+    drwav_data_format formato;
+    formato.container = drwav_container_riff;
+    formato.format = DR_WAVE_FORMAT_PCM;
+    formato.channels = canales;
+    formato.sampleRate = fs;
+    formato.bitsPerSample = 16;
+
+    drwav escritor;
+    if (!drwav_init_file_write(&escritor, ruta, &formato, NULL))
+        throw runtime_error("No se pudo escribir el WAV de prueba");
+    drwav_write_pcm_frames(&escritor, muestras.size() / canales, muestras.data());
+    drwav_uninit(&escritor);
+}
+
+// Codifica una muestra de 16 bits en A-law (G.711)
+uint8_t codificarALaw(int16_t muestra) {
+    int valor = muestra >> 3;
+    uint8_t mascara = 0xD5;
+    if (valor < 0) {
+        mascara = 0x55;
+        valor = -valor - 1;
+    }
+    int segmento = 0;
+    while (segmento < 8 && valor > (0x20 << segmento) - 1) segmento++;
+    if (segmento >= 8) return static_cast<uint8_t>(0x7F ^ mascara);
+    int codigo = segmento << 4;
+    codigo |= segmento < 2 ? (valor >> 1) & 0x0F : (valor >> segmento) & 0x0F;
+    return static_cast<uint8_t>(codigo ^ mascara);
+}
+
+// Codifica una muestra de 16 bits en mu-law (G.711)
+uint8_t codificarMuLaw(int16_t muestra) {
+    const int SESGO = 0x84, LIMITE = 32635;
+    int signo = muestra < 0 ? 0x80 : 0;
+    int valor = min(signo ? -static_cast<int>(muestra) : static_cast<int>(muestra), LIMITE) + SESGO;
+    int exponente = 7;
+    for (int mascara = 0x4000; (valor & mascara) == 0 && exponente > 0; mascara >>= 1) exponente--;
+    int mantisa = (valor >> (exponente + 3)) & 0x0F;
+    return static_cast<uint8_t>(~(signo | (exponente << 4) | mantisa));
+}
+
+/*
+Escribe la señal como WAV IMA ADPCM mono. dr_wav no escribe formatos comprimidos,
+así que los chunks se arman a mano: bloques de 256 bytes con cabecera (predictor
+y paso) y 505 muestras cada uno, más un chunk "fact" con el total de muestras.
+El codificador reproduce el predictor del decodificador para no acumular deriva.
+*/
+void escribirWavIMAADPCM(const char* ruta, const vector<int16_t>& muestras, unsigned int fs) {
+    static const int INDICES[16] = {-1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8};
+    static const int PASOS[89] = {
+        7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+        50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+        253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+        1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+        3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442,
+        11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+    };
+    const size_t BYTES_BLOQUE = 256;
+    const size_t MUESTRAS_BLOQUE = (BYTES_BLOQUE - 4) * 2 + 1;
+
+    vector<uint8_t> datos;
+    int indice = 0;
+    for (size_t inicio = 0; inicio < muestras.size(); inicio += MUESTRAS_BLOQUE) {
+        int predictor = muestras[inicio];
+        datos.push_back(static_cast<uint8_t>(predictor & 0xFF));
+        datos.push_back(static_cast<uint8_t>((predictor >> 8) & 0xFF));
+        datos.push_back(static_cast<uint8_t>(indice));
+        datos.push_back(0);
+
+        uint8_t byte = 0;
+        for (size_t k = 1; k < MUESTRAS_BLOQUE; k++) {
+            size_t i = inicio + k;
+            int diferencia = (i < muestras.size() ? muestras[i] : 0) - predictor;
+            int paso = PASOS[indice];
+            int codigo = 0;
+            if (diferencia < 0) {
+                codigo = 8;
+                diferencia = -diferencia;
+            }
+            if (diferencia >= paso) { codigo |= 4; diferencia -= paso; }
+            if (diferencia >= paso >> 1) { codigo |= 2; diferencia -= paso >> 1; }
+            if (diferencia >= paso >> 2) codigo |= 1;
+
+            // Mismo cálculo que el decodificador
+            int delta = paso >> 3;
+            if (codigo & 1) delta += paso >> 2;
+            if (codigo & 2) delta += paso >> 1;
+            if (codigo & 4) delta += paso;
+            if (codigo & 8) delta = -delta;
+            predictor = max(-32768, min(32767, predictor + delta));
+            indice = max(0, min(88, indice + INDICES[codigo]));
+
+            if (k % 2 == 1) {
+                byte = static_cast<uint8_t>(codigo);
+            } else {
+                datos.push_back(static_cast<uint8_t>(byte | (codigo << 4)));
+            }
+        }
+    }
+
+    auto escribir16 = [](ofstream& f, uint16_t v) { uint8_t b[2] = {uint8_t(v), uint8_t(v >> 8)}; f.write(reinterpret_cast<char*>(b), 2); };
+    auto escribir32 = [](ofstream& f, uint32_t v) { uint8_t b[4] = {uint8_t(v), uint8_t(v >> 8), uint8_t(v >> 16), uint8_t(v >> 24)}; f.write(reinterpret_cast<char*>(b), 4); };
+
+    ofstream archivo(ruta, ios::binary);
+    if (!archivo) throw runtime_error("No se pudo escribir el WAV de prueba");
+    archivo.write("RIFF", 4);
+    escribir32(archivo, static_cast<uint32_t>(4 + (8 + 20) + (8 + 4) + 8 + datos.size()));
+    archivo.write("WAVEfmt ", 8);
+    escribir32(archivo, 20);
+    escribir16(archivo, DR_WAVE_FORMAT_DVI_ADPCM);
+    escribir16(archivo, 1);
+    escribir32(archivo, fs);
+    escribir32(archivo, static_cast<uint32_t>(fs * BYTES_BLOQUE / MUESTRAS_BLOQUE));
+    escribir16(archivo, BYTES_BLOQUE);
+    escribir16(archivo, 4);
+    escribir16(archivo, 2);
+    escribir16(archivo, MUESTRAS_BLOQUE);
+    archivo.write("fact", 4);
+    escribir32(archivo, 4);
+    escribir32(archivo, static_cast<uint32_t>(muestras.size()));
+    archivo.write("data", 4);
+    escribir32(archivo, static_cast<uint32_t>(datos.size()));
+    archivo.write(reinterpret_cast<const char*>(datos.data()), datos.size());
+}
+
+// Escribe una señal en [-1, 1] como WAV mono en el formato indicado (PCM, flotante, A-law, mu-law o IMA ADPCM)
+void escribirWavFormato(const char* ruta, const vector<double>& senal, unsigned int fs,
+                        drwav_uint32 formato_wav, drwav_uint32 bits) {
+    auto entero16 = [](double x) { return static_cast<int16_t>(max(-32768.0, min(32767.0, round(x * 32768.0)))); };
+    if (formato_wav == DR_WAVE_FORMAT_DVI_ADPCM) {
+        vector<int16_t> muestras(senal.size());
+        for (size_t i = 0; i < senal.size(); i++) muestras[i] = entero16(senal[i]);
+        escribirWavIMAADPCM(ruta, muestras, fs);
+        return;
+    }
+    if (formato_wav == DR_WAVE_FORMAT_ALAW || formato_wav == DR_WAVE_FORMAT_MULAW) bits = 8;
+
+    size_t bytes = bits / 8;
+    vector<uint8_t> crudo(senal.size() * bytes);
+    for (size_t i = 0; i < senal.size(); i++) {
+        uint8_t* destino = &crudo[i * bytes];
+        if (formato_wav == DR_WAVE_FORMAT_ALAW || formato_wav == DR_WAVE_FORMAT_MULAW) {
+            int16_t muestra = entero16(senal[i]);
+            *destino = formato_wav == DR_WAVE_FORMAT_ALAW ? codificarALaw(muestra) : codificarMuLaw(muestra);
+        } else if (formato_wav == DR_WAVE_FORMAT_IEEE_FLOAT && bits == 64) {
+            memcpy(destino, &senal[i], sizeof(double));
+        } else if (formato_wav == DR_WAVE_FORMAT_IEEE_FLOAT) {
+            float f = static_cast<float>(senal[i]);
+            memcpy(destino, &f, sizeof(f));
+        } else {
+            // Entero con signo little-endian de 'bits' bits
+            double escala = ldexp(1.0, bits - 1);
+            int64_t v = static_cast<int64_t>(llround(senal[i] * escala));
+            v = max<int64_t>(min<int64_t>(v, static_cast<int64_t>(escala) - 1), -static_cast<int64_t>(escala));
+            for (size_t b = 0; b < bytes; b++) destino[b] = static_cast<uint8_t>((v >> (8 * b)) & 0xFF);
+        }
+    }
+
+    drwav_data_format formato;
+    formato.container = drwav_container_riff;
+    formato.format = formato_wav;
+    formato.channels = 1;
+    formato.sampleRate = fs;
+    formato.bitsPerSample = bits;
+
+    drwav escritor;
+    if (!drwav_init_file_write(&escritor, ruta, &formato, NULL))
+        throw runtime_error("No se pudo escribir el WAV de prueba");
+    drwav_write_pcm_frames(&escritor, senal.size(), crudo.data());
+    drwav_uninit(&escritor);
+}
+
+// ========== PRUEBAS UNITARIAS ==========
+void pruebasUnitarias() {
+    cout << "\n========== PRUEBAS UNITARIAS ==========\n" << endl;
+    int pruebas_exitosas = 0;
+    int pruebas_totales = 0;
+
+    // Prueba 1: FFT de señal simple
+    pruebas_totales++;
+    try {
+        vector<double> senal = {1.0, 0.0, -1.0, 0.0};
+        vector<complex<double>> resultado = fft_real(senal);
+        if (resultado.size() == 4) {
+            cout << "[OK] Prueba 1: FFT procesa señal correctamente" << endl;
+            pruebas_exitosas++;
+        } else {
+            cout << "[FAIL] Prueba 1: Tamaño incorrecto" << endl;
+        }
+    } catch (...) {
+        cout << "[FAIL] Prueba 1: Excepción inesperada" << endl;
+    }
+
+    // Prueba 2: FFT requiere potencia de 2
+    pruebas_totales++;
+    try {
+        vector<complex<double>> senal_invalida = {{1,0}, {2,0}, {3,0}};
+        fft(senal_invalida);
+        cout << "[FAIL] Prueba 2: No detectó tamaño inválido" << endl;
+    } catch (runtime_error& e) {
+        cout << "[OK] Prueba 2: FFT rechaza tamaño no potencia de 2" << endl;
+        pruebas_exitosas++;
+    }
+
+    // Prueba 3: IFFT recupera señal original
+    pruebas_totales++;
+    try {
+        vector<double> original = {1.0, 2.0, 3.0, 4.0};
+        vector<complex<double>> fft_result = fft_real(original);
+        vector<double> recuperada = ifft_real(fft_result);
+        bool correcto = true;
+        for (size_t i = 0; i < original.size(); i++) {
+            if (abs(original[i] - recuperada[i]) > 0.001) {
+                correcto = false;
                 break;
             }
         }
         if (correcto) {
-            cout << "[OK] Prueba 3: IFFT recupera señal original" << endl;
+            cout << "[OK] Prueba 3: IFFT recupera señal original" << endl;
+            pruebas_exitosas++;
+        } else {
+            cout << "[FAIL] Prueba 3: Señal recuperada difiere del original" << endl;
+        }
+    } catch (...) {
+        cout << "[FAIL] Prueba 3: Excepción inesperada" << endl;
+    }
+
+    // Prueba 4: Detección de picos con umbral
+    pruebas_totales++;
+    try {
+        vector<double> senal = {0.1, 0.5, 0.3, 0.8, 0.2, 0.9, 0.1};
+        vector<size_t> picos = detectarPicos(senal, 0.5, 1);
+        if (picos.size() >= 2) {
+            cout << "[OK] Prueba 4: Detector de picos funciona" << endl;
+            pruebas_exitosas++;
+        } else {
+            cout << "[FAIL] Prueba 4: No detectó picos esperados" << endl;
+        }
+    } catch (...) {
+        cout << "[FAIL] Prueba 4: Excepción inesperada" << endl;
+    }
+
+    // Prueba 5: Cálculo de BPM válido
+    pruebas_totales++;
+    try {
+        vector<double> senal(1000, 0.0);
+        double fs = 1000.0;
+        for (int i = 0; i < 10; i++) {
+            int pos = i * 100;
+            if (pos < (int)senal.size()) senal[pos] = 1.0;
+        }
+        ResultadosBPM resultado = extraerBPM(senal, fs, 0.5, 50);
+        if (resultado.bpm_promedio > 0 && resultado.bpm_promedio < 200) {
+            cout << "[OK] Prueba 5: Cálculo de BPM genera valor válido" << endl;
+            pruebas_exitosas++;
+        } else {
+            cout << "[FAIL] Prueba 5: BPM fuera de rango esperado" << endl;
+        }
+    } catch (...) {
+        cout << "[FAIL] Prueba 5: Excepción inesperada" << endl;
+    }
+
+    // Prueba 6: Detección de bradicardia
+    pruebas_totales++;
+    try {
+        ResultadosBPM datos_bradi;
+        datos_bradi.bpm_promedio = 50.0;
+        datos_bradi.intervalos_rr_segundos = {1.2, 1.2, 1.2};
+        Anomalias resultado = detectarAnomalias(datos_bradi);
+        if (resultado.bradicardia) {
+            cout << "[OK] Prueba 6: Detecta bradicardia (BPM < 60)" << endl;
+            pruebas_exitosas++;
+        } else {
+            cout << "[FAIL] Prueba 6: No detectó bradicardia" << endl;
+        }
+    } catch (...) {
+        cout << "[FAIL] Prueba 6: Excepción inesperada" << endl;
+    }
+
+    // Prueba 7: Detección de taquicardia
+    pruebas_totales++;
+    try {
+        ResultadosBPM datos_taqui;
+        datos_taqui.bpm_promedio = 120.0;
+        datos_taqui.intervalos_rr_segundos = {0.5, 0.5, 0.5};
+        Anomalias resultado = detectarAnomalias(datos_taqui);
+        if (resultado.taquicardia) {
+            cout << "[OK] Prueba 7: Detecta taquicardia (BPM > 100)" << endl;
+            pruebas_exitosas++;
+        } else {
+            cout << "[FAIL] Prueba 7: No detectó taquicardia" << endl;
+        }
+    } catch (...) {
+        cout << "[FAIL] Prueba 7: Excepción inesperada" << endl;
+    }
+
+    // Prueba 8: Siguiente potencia de 2
+    pruebas_totales++;
+    try {
+        if (siguiente_potencia2(100) == 128 && siguiente_potencia2(256) == 256) {
+            cout << "[OK] Prueba 8: Cálculo de siguiente potencia de 2 correcto" << endl;
+            pruebas_exitosas++;
+        } else {
+            cout << "[FAIL] Prueba 8: Cálculo incorrecto de potencia de 2" << endl;
+        }
+    } catch (...) {
+        cout << "[FAIL] Prueba 8: Excepción inesperada" << endl;
+    }
+
+    // Prueba 9: IFFT decimada coincide con la IFFT completa
+    pruebas_totales++;
+    try {
+        double fs = 1000.0;
+        vector<double> senal(4096);
+        for (size_t i = 0; i < senal.size(); i++) {
+            senal[i] = sin(2 * PI * 1.2 * i / fs) + 0.5 * sin(2 * PI * 40 * i / fs);
+        }
+        vector<complex<double>> espectro = obtenerEspectroParaFiltrado(senal);
+        filtrarFrecuencias(espectro, fs);
+        vector<double> completa = ifft_real(espectro);
+        SenalDecimada decimada = ifft_real_decimada(espectro, fs, 50.0);
+        bool correcto = decimada.factor > 1 &&
+                        decimada.muestras.size() * decimada.factor == completa.size();
+        for (size_t m = 0; correcto && m < decimada.muestras.size(); m++) {
+            if (abs(decimada.muestras[m] - completa[m * decimada.factor]) > 1e-9) {
+                correcto = false;
+            }
+        }
+        if (correcto) {
+            cout << "[OK] Prueba 9: IFFT decimada coincide con la IFFT completa (factor "
+                 << decimada.factor << ")" << endl;
+            pruebas_exitosas++;
+        } else {
+            cout << "[FAIL] Prueba 9: IFFT decimada difiere de la IFFT completa" << endl;
+        }
+    } catch (...) {
+        cout << "[FAIL] Prueba 9: Excepción inesperada" << endl;
+    }
+
+    // Prueba 10: Lectura de WAV mapeado en memoria sin copias
+    pruebas_totales++;
+    try {
+        const char* ruta_temporal = "prueba_mapeo.tmp.wav";
+        vector<int16_t> muestras = {0, 16384, -16384, 32767, -32768, 1234};
+        escribirWavPrueba(ruta_temporal, muestras, 8000);
+
+        bool correcto;
+        {
+            AudioMapeado audio(ruta_temporal);
+            correcto = audio.esCopiaCero() && audio.numMuestras() == muestras.size();
+            for (size_t i = 0; correcto && i < muestras.size(); i++) {
+                if (audio.muestra(i) != muestras[i] / 32768.0) correcto = false;
+            }
+        }
+        remove(ruta_temporal);
+
+        if (correcto) {
+            cout << "[OK] Prueba 10: WAV mapeado expone las muestras PCM sin copias" << endl;
+            pruebas_exitosas++;
+        } else {
+            cout << "[FAIL] Prueba 10: Muestras del WAV mapeado incorrectas" << endl;
+        }
+    } catch (...) {
+        cout << "[FAIL] Prueba 10: Excepción inesperada" << endl;
+    }
+
+    // Prueba 11: Lectura por bloques de tamaño acotado
+    pruebas_totales++;
+    try {
+        const char* ruta_temporal = "prueba_flujo.tmp.wav";
+        vector<int16_t> muestras(10000);
+        for (size_t i = 0; i < muestras.size(); i++) {
+            muestras[i] = static_cast<int16_t>((i * 37) % 65536 - 32768);
+        }
+        escribirWavPrueba(ruta_temporal, muestras, 8000);
+
+        bool correcto = true;
+        size_t total = 0;
+        {
+            WavStream flujo(ruta_temporal, 4096);
+            vector<double> bloque;
+            while (flujo.siguienteBloque(bloque)) {
+                if (bloque.size() > flujo.tamBloque()) correcto = false;
+                for (size_t i = 0; correcto && i < bloque.size(); i++) {
+                    if (bloque[i] != muestras[total + i] / 32768.0) correcto = false;
+                }
+                total += bloque.size();
+            }
+        }
+        remove(ruta_temporal);
+
+        if (correcto && total == muestras.size()) {
+            cout << "[OK] Prueba 11: WavStream entrega bloques acotados y completos" << endl;
+            pruebas_exitosas++;
+        } else {
+            cout << "[FAIL] Prueba 11: Bloques de WavStream incorrectos" << endl;
+        }
+    } catch (...) {
+        cout << "[FAIL] Prueba 11: Excepción inesperada" << endl;
+    }
+
+    // Prueba 12: WAV de 24 bits conserva su precisión al decodificar
+    pruebas_totales++;
+    try {
+        const char* ruta_temporal = "prueba_24bits.tmp.wav";
+        vector<double> senal(1000);
+        for (size_t i = 0; i < senal.size(); i++) {
+            senal[i] = 0.9 * sin(2 * PI * 3.0 * i / senal.size());
+        }
+        escribirWavFormato(ruta_temporal, senal, 8000, DR_WAVE_FORMAT_PCM, 24);
+
+        double error_flujo = 0.0, error_mapeado = 0.0;
+        {
+            WavStream flujo(ruta_temporal);
+            AudioMapeado audio(ruta_temporal);
+            vector<double> bloque;
+            size_t total = 0;
+            while (flujo.siguienteBloque(bloque)) {
+                for (size_t i = 0; i < bloque.size(); i++) {
+                    error_flujo = max(error_flujo, abs(bloque[i] - senal[total + i]));
+                    error_mapeado = max(error_mapeado, abs(audio.muestra(total + i) - senal[total + i]));
+                }
+                total += bloque.size();
+            }
+        }
+        remove(ruta_temporal);
+
+        // En 64 bits se usan muestras que float no puede representar: deben volver bit a bit
+        const char* ruta_f64 = "prueba_f64.tmp.wav";
+        vector<double> senal_f64(5000);
+        for (size_t i = 0; i < senal_f64.size(); i++) {
+            senal_f64[i] = 0.9 * sin(2 * PI * 3.0 * i / senal_f64.size()) + 1e-12 * (i + 1);
+        }
+        escribirWavFormato(ruta_f64, senal_f64, 8000, DR_WAVE_FORMAT_IEEE_FLOAT, 64);
+        bool no_float = true;
+        for (double valor : senal_f64) no_float = no_float && static_cast<double>(static_cast<float>(valor)) != valor;
+
+        vector<double> flujo_f64;
+        bool mapeado_exacto = true;
+        {
+            WavStream flujo(ruta_f64);
+            vector<double> bloque;
+            while (flujo.siguienteBloque(bloque)) flujo_f64.insert(flujo_f64.end(), bloque.begin(), bloque.end());
+            // Según la alineación del chunk, se lee del mapeo o se decodifica por la ruta de 64 bits
+            AudioMapeado audio(ruta_f64);
+            for (size_t i = 0; i < senal_f64.size(); i++) mapeado_exacto = mapeado_exacto && audio.muestra(i) == senal_f64[i];
+        }
+        bool paralelo_exacto = decodificarWavParalelo(ruta_f64, 4) == senal_f64;
+        remove(ruta_f64);
+
+        // Con la ruta de 16 bits el error sería del orden de 1/65536
+        if (error_flujo < 1e-6 && error_mapeado < 1e-6 && no_float && flujo_f64 == senal_f64 && mapeado_exacto &&
+            paralelo_exacto) {
+            cout << "[OK] Prueba 12: WAV de 24 bits y flotante de 64 bits se decodifican sin perder precisión" << endl;
+            pruebas_exitosas++;
+        } else {
+            cout << "[FAIL] Prueba 12: Pérdida de precisión en WAV de 24 bits o flotante de 64 bits" << endl;
+        }
+    } catch (...) {
+        cout << "[FAIL] Prueba 12: Excepción inesperada" << endl;
+    }
+
+    // Prueba 13: Audio estéreo separado por canal y analizado en paralelo
+    pruebas_totales++;
+    try {
+        const char* ruta_temporal = "prueba_estereo.tmp.wav";
+        double fs = 1000.0;
+        size_t cuadros = 10000;
+        vector<int16_t> entrelazado(cuadros * 2);
+        vector<vector<double>> esperado(2, vector<double>(cuadros));
+        for (size_t i = 0; i < cuadros; i++) {
+            esperado[0][i] = 0.5 * sin(2 * PI * 1.25 * i / fs);          // 75 bpm
+            esperado[1][i] = 0.4 * sin(2 * PI * 1.25 * i / fs + 0.5);
+            entrelazado[2 * i]     = static_cast<int16_t>(esperado[0][i] * 32768.0);
+            entrelazado[2 * i + 1] = static_cast<int16_t>(esperado[1][i] * 32768.0);
+        }
+        escribirWavPrueba(ruta_temporal, entrelazado, static_cast<unsigned int>(fs), 2);
+
+        bool correcto = true;
+        ResultadosMulticanal resultados;
+        {
+            AudioMapeado audio(ruta_temporal);
+            vector<vector<double>> canales = desentrelazarCanales(audio);
+            correcto = canales.size() == 2 && canales[0].size() == cuadros;
+            for (size_t c = 0; correcto && c < 2; c++) {
+                for (size_t i = 0; i < cuadros; i++) {
+                    if (abs(canales[c][i] - esperado[c][i]) > 1.0 / 32768.0) { correcto = false; break; }
+                }
+            }
+            if (correcto) resultados = analizarCanales(canales, fs);
+        }
+        remove(ruta_temporal);
+
+        if (correcto && resultados.por_canal.size() == 2 && abs(resultados.bpm_consenso - 75.0) < 2.0) {
+            cout << "[OK] Prueba 13: Audio estéreo analizado por canal (consenso "
+                 << resultados.bpm_consenso << " bpm)" << endl;
+            pruebas_exitosas++;
+        } else {
+            cout << "[FAIL] Prueba 13: Análisis multicanal incorrecto" << endl;
+        }
+    } catch (...) {
+        cout << "[FAIL] Prueba 13: Excepción inesperada" << endl;
+    }
+
+    // Prueba 14: Decodificación paralela por rangos igual a la serie
+    pruebas_totales++;
+    try {
+        const char* ruta_temporal = "prueba_paralelo.tmp.wav";
+        vector<double> senal(300007);   // suficiente para repartir entre 4 hilos
+        for (size_t i = 0; i < senal.size(); i++) {
+            senal[i] = 0.7 * sin(2 * PI * 5.0 * i / 8000.0);
+        }
+
+        bool correcto = true;
+        for (drwav_uint32 bits : {16u, 24u}) {
+            escribirWavFormato(ruta_temporal, senal, 8000, DR_WAVE_FORMAT_PCM, bits);
+
+            vector<double> serie;
+            {
+                WavStream flujo(ruta_temporal);
+                vector<double> bloque;
+                while (flujo.siguienteBloque(bloque)) serie.insert(serie.end(), bloque.begin(), bloque.end());
+            }
+            vector<double> paralelo = decodificarWavParalelo(ruta_temporal, 4);
+            if (paralelo != serie || paralelo.size() != senal.size()) correcto = false;
+        }
+
+        // Archivo truncado a mitad de los datos: la salida termina en el corte, sin huecos
+        escribirWavFormato(ruta_temporal, senal, 8000, DR_WAVE_FORMAT_PCM, 16);
+        string bytes;
+        {
+            ifstream entrada(ruta_temporal, ios::binary);
+            bytes.assign(istreambuf_iterator<char>(entrada), istreambuf_iterator<char>());
+        }
+        size_t cuadros_truncados = senal.size() * 2 / 5;
+        size_t inicio_datos = bytes.size() - senal.size() * sizeof(int16_t);
+        {
+            ofstream salida(ruta_temporal, ios::binary | ios::trunc);
+            salida.write(bytes.data(), inicio_datos + cuadros_truncados * sizeof(int16_t));
+        }
+        vector<double> truncado = decodificarWavParalelo(ruta_temporal, 4);
+        if (truncado.size() != cuadros_truncados) correcto = false;
+        for (size_t i = 0; i < truncado.size() && correcto; i++) {
+            if (abs(truncado[i] - senal[i]) > 1.0 / 32768) correcto = false;
+        }
+        remove(ruta_temporal);
+
+        if (correcto) {
+            cout << "[OK] Prueba 14: Decodificación paralela coincide con la decodificación en serie" << endl;
+            pruebas_exitosas++;
+        } else {
+            cout << "[FAIL] Prueba 14: Decodificación paralela difiere de la serie" << endl;
+        }
+    } catch (...) {
+        cout << "[FAIL] Prueba 14: Excepción inesperada" << endl;
+    }
+
+    // Prueba 15: Lectura de tramos con salto al cuadro inicial
+    pruebas_totales++;
+    try {
+        const char* ruta_temporal = "prueba_segmento.tmp.wav";
+        vector<int16_t> muestras(10000);   // 10 s a 1000 Hz
+        for (size_t i = 0; i < muestras.size(); i++) {
+            muestras[i] = static_cast<int16_t>(i);
+        }
+        escribirWavPrueba(ruta_temporal, muestras, 1000);
+
+        bool correcto = true;
+        {
+            WavStream flujo(ruta_temporal, 256);
+            vector<RangoTiempo> rangos = {{6.0, 7.5}, {2.5, 4.0}, {9.5, 20.0}};
+            vector<size_t> inicios = {6000, 2500, 9500};
+            vector<size_t> tamanios = {1500, 1500, 500};
+            for (size_t r = 0; r < rangos.size(); r++) {
+                Grabacion segmento = leerSegmento(flujo, rangos[r]);
+                if (segmento.cuadro_inicio != inicios[r] || segmento.canales[0].size() != tamanios[r]) {
+                    correcto = false;
+                    break;
+                }
+                for (size_t i = 0; i < segmento.canales[0].size(); i++) {
+                    if (segmento.canales[0][i] != (inicios[r] + i) / 32768.0) { correcto = false; break; }
+                }
+            }
+        }
+        remove(ruta_temporal);
+
+        if (correcto) {
+            cout << "[OK] Prueba 15: Tramos de tiempo decodificados correctamente" << endl;
+            pruebas_exitosas++;
+        } else {
+            cout << "[FAIL] Prueba 15: Tramos de tiempo incorrectos" << endl;
+        }
+    } catch (...) {
+        cout << "[FAIL] Prueba 15: Excepción inesperada" << endl;
+    }
+
+    // Prueba 16: Lote con precarga procesa los archivos en orden
+    pruebas_totales++;
+    try {
+        vector<string> rutas = {"prueba_lote_0.tmp.wav", "prueba_lote_1.tmp.wav",
+                                "prueba_lote_inexistente.tmp.wav", "prueba_lote_3.tmp.wav"};
+        for (size_t k = 0; k < rutas.size(); k++) {
+            if (k == 2) continue;
+            escribirWavPrueba(rutas[k].c_str(), vector<int16_t>(1000 * (k + 1), static_cast<int16_t>(k)), 1000);
+        }
+
+        bool correcto = true;
+        size_t procesados = 0;
+        procesarLote(rutas, {0.0, numeric_limits<double>::infinity()},
+                     [&](const string& ruta, const BufferGrabacion& buffer) {
+            if (ruta != rutas[procesados] || buffer.indice != procesados) correcto = false;
+            if (procesados == 2) {
+                if (buffer.error.empty()) correcto = false;
+            } else if (!buffer.error.empty() || buffer.audio.canales[0].size() != 1000 * (procesados + 1) ||
+                       buffer.audio.canales[0][0] != procesados / 32768.0) {
+                correcto = false;
+            }
+            procesados++;
+        });
+        for (const auto& ruta : rutas) remove(ruta.c_str());
+
+        if (correcto && procesados == rutas.size()) {
+            cout << "[OK] Prueba 16: Lote con precarga procesa los archivos en orden" << endl;
+            pruebas_exitosas++;
+        } else {
+            cout << "[FAIL] Prueba 16: Lote con precarga incorrecto" << endl;
+        }
+    } catch (...) {
+        cout << "[FAIL] Prueba 16: Excepción inesperada" << endl;
+    }
+
+    // Prueba 17: Lector de lotes (io_uring o stdio) entrega cada archivo completo
+    pruebas_totales++;
+    try {
+        vector<string> rutas;
+        for (size_t k = 0; k < 5; k++) {
+            rutas.push_back("prueba_uring_" + to_string(k) + ".tmp.wav");
+            vector<int16_t> muestras(3000 * (k + 1));
+            for (size_t i = 0; i < muestras.size(); i++) muestras[i] = static_cast<int16_t>(i + k);
+            escribirWavPrueba(rutas[k].c_str(), muestras, 8000);
+        }
+        rutas.push_back("prueba_uring_inexistente.tmp.wav");
+
+        // Profundidad 2 y bloques de 4 KiB: varios archivos y varias lecturas por archivo
+        LectorLoteUring lector(2, 4096);
+        vector<int> recibidos(rutas.size(), 0);
+        bool correcto = true;
+        lector.leer(rutas, [&](size_t k, const vector<uint8_t>& datos, const string& error) {
+            recibidos[k]++;
+            if (k == 5) {
+                if (error.empty()) correcto = false;
+                return;
+            }
+            vector<double> senal;
+            WavStream flujo(BytesEnMemoria{datos.data(), datos.size()});
+            vector<double> bloque;
+            while (flujo.siguienteBloque(bloque)) senal.insert(senal.end(), bloque.begin(), bloque.end());
+            if (!error.empty() || senal.size() != 3000 * (k + 1) || senal.back() != static_cast<int16_t>(senal.size() - 1 + k) / 32768.0)
+                correcto = false;
+        });
+        for (const auto& ruta : rutas) remove(ruta.c_str());
+
+        if (correcto && count(recibidos.begin(), recibidos.end(), 1) == static_cast<int>(rutas.size())) {
+            cout << "[OK] Prueba 17: Lector de lotes entrega cada archivo completo ("
+                 << (lector.usaIoUring() ? "io_uring" : "stdio") << ")" << endl;
+            pruebas_exitosas++;
+        } else {
+            cout << "[FAIL] Prueba 17: Lector de lotes incorrecto" << endl;
+        }
+    } catch (...) {
+        cout << "[FAIL] Prueba 17: Excepción inesperada" << endl;
+    }
+
+    // Prueba 18: El pipeline usa la frecuencia de muestreo del WAV
+    pruebas_totales++;
+    try {
+        const char* ruta_temporal = "prueba_4khz.tmp.wav";
+        double fs = 4000.0;
+        vector<int16_t> muestras(static_cast<size_t>(fs * 20));
+        for (size_t i = 0; i < muestras.size(); i++) {
+            double fase = fmod(i / fs, 60.0 / 72.0);   // 72 bpm
+            muestras[i] = static_cast<int16_t>(20000 * exp(-pow((fase - 0.1) / 0.04, 2)));
+        }
+        escribirWavPrueba(ruta_temporal, muestras, static_cast<unsigned int>(fs));
+
+        Grabacion grabacion;
+        {
+            WavStream flujo(ruta_temporal);
+            leerSegmento(flujo, {0.0, numeric_limits<double>::infinity()}, grabacion);
+        }
+        remove(ruta_temporal);
+        ResultadosBPM resultados = analizarSenal(grabacion.canales[0], grabacion.frecuencia_muestreo);
+
+        bool plan_reutilizado = planFFT(1024) == planFFT(1024);
+        if (grabacion.frecuencia_muestreo == fs && grabacion.num_canales == 1 &&
+            grabacion.bits_por_muestra == 16 && abs(grabacion.duracion_segundos - 20.0) < 1e-9 &&
+            abs(resultados.bpm_promedio - 72.0) < 1.0 && plan_reutilizado) {
+            cout << "[OK] Prueba 18: Grabación de 4 kHz analizada a su frecuencia ("
+                 << resultados.bpm_promedio << " bpm)" << endl;
+            pruebas_exitosas++;
+        } else {
+            cout << "[FAIL] Prueba 18: Datos de formato o BPM incorrectos" << endl;
+        }
+    } catch (...) {
+        cout << "[FAIL] Prueba 18: Excepción inesperada" << endl;
+    }
+
+    // Prueba 19: Lectura de flujos secuenciales (PCM crudo y WAV con cabecera)
+    pruebas_totales++;
+    try {
+        bool correcto = true;
+
+        // PCM crudo estéreo: 3 s a 1000 Hz, se salta el primer segundo leyendo y descartando
+        FILE* crudo = tmpfile();
+        if (!crudo) throw runtime_error("No se pudo crear el archivo temporal");
+        vector<int16_t> muestras(3000 * 2);
+        for (size_t i = 0; i < muestras.size(); i++) muestras[i] = static_cast<int16_t>(i);
+        fwrite(muestras.data(), sizeof(int16_t), muestras.size(), crudo);
+        rewind(crudo);
+        {
+            FormatoPCMCrudo formato;
+            formato.frecuencia_muestreo = 1000;
+            formato.canales = 2;
+            WavStream flujo(crudo, formato, 256);
+            Grabacion grabacion;
+            leerSegmento(flujo, {1.0, numeric_limits<double>::infinity()}, grabacion);
+            correcto = grabacion.canales.size() == 2 && grabacion.canales[1].size() == 2000 &&
+                       grabacion.canales[0][0] == 2000 / 32768.0 && grabacion.canales[1][1999] == 5999 / 32768.0;
+        }
+        fclose(crudo);
+
+        // WAV con cabecera leído como flujo, sin buscar hacia atrás
+        const char* ruta_temporal = "prueba_secuencial.tmp.wav";
+        escribirWavPrueba(ruta_temporal, vector<int16_t>(muestras.begin(), muestras.begin() + 1500), 500);
+        FILE* entrada = fopen(ruta_temporal, "rb");
+        if (!entrada) throw runtime_error("No se pudo abrir el WAV de prueba");
+        {
+            WavStream flujo(entrada);
+            vector<double> bloque, senal;
+            while (flujo.siguienteBloque(bloque)) senal.insert(senal.end(), bloque.begin(), bloque.end());
+            if (flujo.frecuenciaMuestreo() != 500 || senal.size() != 1500 || senal[1499] != 1499 / 32768.0)
+                correcto = false;
+        }
+        fclose(entrada);
+        remove(ruta_temporal);
+
+        if (correcto) {
+            cout << "[OK] Prueba 19: Flujos secuenciales (PCM crudo y WAV) leídos correctamente" << endl;
+            pruebas_exitosas++;
+        } else {
+            cout << "[FAIL] Prueba 19: Lectura de flujos secuenciales incorrecta" << endl;
+        }
+    } catch (...) {
+        cout << "[FAIL] Prueba 19: Excepción inesperada" << endl;
+    }
+
+    // Prueba 20: Caché de señal decimada (ida y vuelta, tramo por tiempo, validación, huella)
+    pruebas_totales++;
+    try {
+        const char* ruta_cache = "prueba_cache.tmp.fcc";
+        SenalDecimada senal;
+        senal.frecuencia_muestreo = 125.0;
+        senal.factor = 64;
+        for (size_t i = 0; i < 1000; i++) senal.muestras.push_back(sin(2 * PI * 1.2 * i / 125.0));
+        vector<complex<double>> espectro(16, complex<double>(0.0, 0.0));
+        espectro[2] = {1.0, -0.5};
+        espectro[14] = conj(espectro[2]);
+
+        escribirCacheDecimada(ruta_cache, senal, 11, 22, 64000, &espectro, 100);
+        bool correcto = true;
+        {
+            CacheDecimada cache(ruta_cache);
+            SenalDecimada leida = cache.senal();
+            if (!cache.coincide(11, 22) || cache.coincide(12, 22) || leida.factor != 64 ||
+                leida.muestras.size() != 1000 || cache.cabecera().num_trozos != 10)
+                correcto = false;
+            for (size_t i = 0; correcto && i < leida.muestras.size(); i++)
+                if (abs(leida.muestras[i] - senal.muestras[i]) > 1e-6) correcto = false;
+
+            // 3.3 s a 125 Hz empieza en la muestra 413, dentro del trozo 4
+            size_t primera;
+            SenalDecimada tramo = cache.tramo({3.3, 4.0}, primera);
+            if (primera != 413 || tramo.muestras.size() != 500 - 413 ||
+                abs(tramo.muestras[0] - senal.muestras[413]) > 1e-6)
+                correcto = false;
+            if (cache.espectro() != espectro) correcto = false;
+        }
+
+        // Una caché truncada se rechaza sin leer fuera del archivo
+        FILE* truncada = fopen(ruta_cache, "r+b");
+        fseek(truncada, 0, SEEK_END);
+        long tamano = ftell(truncada);
+        fclose(truncada);
+        vector<char> bytes(static_cast<size_t>(tamano) / 2);
+        ifstream(ruta_cache, ios::binary).read(bytes.data(), bytes.size());
+        ofstream(ruta_cache, ios::binary | ios::trunc).write(bytes.data(), bytes.size());
+        SenalDecimada descartada;
+        if (leerCacheDecimada(ruta_cache, 11, 22, descartada)) correcto = false;
+        remove(ruta_cache);
+
+        // La huella rápida es estable y cambia si cambia el final del archivo
+        const char* ruta_wav = "prueba_huella.tmp.wav";
+        vector<int16_t> muestras(200000);
+        for (size_t i = 0; i < muestras.size(); i++) muestras[i] = static_cast<int16_t>(i * 7);
+        escribirWavPrueba(ruta_wav, muestras, 8000);
+        uint64_t huella = huellaContenido(ruta_wav);
+        if (huellaContenido(ruta_wav) != huella || huellaContenido(ruta_wav, true) == huella) correcto = false;
+        muestras.back() ^= 1;
+        escribirWavPrueba(ruta_wav, muestras, 8000);
+        if (huellaContenido(ruta_wav) == huella) correcto = false;
+        remove(ruta_wav);
+
+        if (correcto) {
+            cout << "[OK] Prueba 20: Caché de señal decimada consistente" << endl;
+            pruebas_exitosas++;
+        } else {
+            cout << "[FAIL] Prueba 20: Caché de señal decimada incorrecta" << endl;
+        }
+    } catch (...) {
+        cout << "[FAIL] Prueba 20: Excepción inesperada" << endl;
+    }
+
+    // Prueba 21: Escritura por bloques de la señal filtrada con pista de picos
+    pruebas_totales++;
+    try {
+        const char* ruta_temporal = "prueba_filtrada.tmp.wav";
+        SenalDecimada senal;
+        senal.frecuencia_muestreo = 125.0;
+        senal.factor = 64;
+        for (size_t i = 0; i < 10000; i++) senal.muestras.push_back(sin(2 * PI * i / 125.0));
+        vector<size_t> picos = {31 * 64, 4096 * 64, 9999 * 64};   // en muestras originales; uno en el borde de bloque
+        escribirSenalFiltrada(ruta_temporal, senal, picos, 4096);
+
+        unsigned int canales, fs;
+        drwav_uint64 cuadros;
+        float* leido = drwav_open_file_and_read_pcm_frames_f32(ruta_temporal, &canales, &fs, &cuadros, NULL);
+        bool correcto = leido && canales == 2 && fs == 125 && cuadros == 10000;
+        size_t marcas = 0;
+        for (size_t i = 0; correcto && i < cuadros; i++) {
+            if (abs(leido[2 * i] - senal.muestras[i]) > 1e-6) correcto = false;
+            if (leido[2 * i + 1] != 0.0f) marcas++;
+        }
+        correcto = correcto && marcas == 3 && leido[2 * 31 + 1] == 1.0f && leido[2 * 4096 + 1] == 1.0f &&
+                   leido[2 * 9999 + 1] == 1.0f;
+        drwav_free(leido, NULL);
+
+        // 44100 / 256 = 172.27 Hz no es entero: se escribe a 172 Hz conservando tiempos y picos
+        SenalDecimada no_entera;
+        no_entera.frecuencia_muestreo = 44100.0 / 256;
+        no_entera.factor = 256;
+        for (size_t i = 0; i < 10000; i++) no_entera.muestras.push_back(sin(2 * PI * 1.2 * i / no_entera.frecuencia_muestreo));
+        vector<size_t> picos_no_entera = {100 * 256, 4100 * 256, 9990 * 256};
+        escribirSenalFiltrada(ruta_temporal, no_entera, picos_no_entera, 4096);
+        leido = drwav_open_file_and_read_pcm_frames_f32(ruta_temporal, &canales, &fs, &cuadros, NULL);
+        double paso = no_entera.frecuencia_muestreo / 172.0;
+        correcto = correcto && leido && fs == 172 && cuadros == static_cast<drwav_uint64>(floor(9999 / paso)) + 1;
+        marcas = 0;
+        for (size_t i = 0; correcto && i < cuadros; i++) {
+            if (abs(leido[2 * i] - sin(2 * PI * 1.2 * i / 172.0)) > 1e-3) correcto = false;
+            if (leido[2 * i + 1] != 0.0f) marcas++;
+        }
+        for (size_t pico : picos_no_entera)
+            correcto = correcto && leido[2 * llround(pico / 256 / paso) + 1] == 1.0f;
+        correcto = correcto && marcas == 3;
+        drwav_free(leido, NULL);
+        remove(ruta_temporal);
+
+        if (correcto) {
+            cout << "[OK] Prueba 21: Señal filtrada y marcas de picos escritas correctamente" << endl;
+            pruebas_exitosas++;
+        } else {
+            cout << "[FAIL] Prueba 21: WAV de señal filtrada incorrecto" << endl;
+        }
+    } catch (...) {
+        cout << "[FAIL] Prueba 21: Excepción inesperada" << endl;
+    }
+
+    // Prueba 22: Detector en línea no se anula con un artefacto aislado
+    pruebas_totales++;
+    try {
+        // 30 latidos a 60 bpm (fs = 100 Hz), rizado pequeño y un artefacto 20 veces más alto
+        double fs = 100.0;
+        vector<double> senal(3000);
+        for (size_t i = 0; i < senal.size(); i++) {
+            double t = i / fs;
+            double fase = t - floor(t) - 0.5;
+            senal[i] = exp(-fase * fase / (2 * 0.03 * 0.03)) + 0.05 * sin(2 * PI * 7 * t);
+        }
+        senal[1020] = 20.0;
+
+        vector<size_t> picos;
+        DetectorPicosEnLinea detector(fs);
+        for (size_t inicio = 0; inicio < senal.size(); inicio += 37)
+            detector.procesarBloque(senal.data() + inicio, min<size_t>(37, senal.size() - inicio), picos);
+        detector.finalizar(picos);
+
+        size_t latidos = 0;
+        for (size_t pico : picos)
+            if (pico % 100 == 50) latidos++;
+        size_t con_umbral_global = detectarPicos(senal, 0.7, 20).size();
+
+        if (latidos == 30 && picos.size() == 31 && con_umbral_global == 1) {
+            cout << "[OK] Prueba 22: Detector en línea encuentra los 30 latidos pese al artefacto" << endl;
+            pruebas_exitosas++;
+        } else {
+            cout << "[FAIL] Prueba 22: Detector en línea encontró " << latidos << " latidos de 30" << endl;
+        }
+    } catch (...) {
+        cout << "[FAIL] Prueba 22: Excepción inesperada" << endl;
+    }
+
+    // Prueba 23: En cada periodo refractario gana el pico más alto
+    pruebas_totales++;
+    try {
+        // Pico bajo en 10 y alto en 15 (distancia 10): debe quedar el de 15; empate en 40 y 45: el primero
+        vector<double> senal(60, 0.0);
+        senal[10] = 0.8;
+        senal[15] = 1.0;
+        senal[40] = 0.9;
+        senal[45] = 0.9;
+        bool correcto = detectarPicos(senal, 0.5, 10) == vector<size_t>({15, 40});
+
+        // Comparación con la definición directa sobre una señal aleatoria
+        vector<double> ruido(5000);
+        for (double& v : ruido) v = rand() % 1000 / 1000.0;
+        size_t distancia = 7;
+        vector<size_t> esperado;
+        for (size_t i = 1; i + 1 < ruido.size(); i++) {
+            auto candidato = [&](size_t j) { return ruido[j] > 0.3 && ruido[j] > ruido[j - 1] && ruido[j] > ruido[j + 1]; };
+            if (!candidato(i)) continue;
+            bool gana = true;
+            for (size_t j = (i >= distancia ? i - distancia + 1 : 1); j < min(i + distancia, ruido.size() - 1) && gana; j++) {
+                if (j != i && candidato(j) && (ruido[j] > ruido[i] || (ruido[j] == ruido[i] && j < i))) gana = false;
+            }
+            if (gana) esperado.push_back(i);
+        }
+        double maximo = *max_element(ruido.begin(), ruido.end());
+        correcto = correcto && detectarPicos(ruido, 0.3 / maximo, static_cast<int>(distancia)) == esperado;
+
+        // Por tramos en paralelo el resultado es el mismo que en serie
+        ruido.resize(400000);
+        for (double& v : ruido) v = rand() % 1000 / 1000.0;
+        correcto = correcto && detectarPicos(ruido, 0.5, 50, 4) == detectarPicos(ruido, 0.5, 50, 1);
+
+        if (correcto) {
+            cout << "[OK] Prueba 23: Periodo refractario conserva el pico más alto" << endl;
+            pruebas_exitosas++;
+        } else {
+            cout << "[FAIL] Prueba 23: Selección de picos en el periodo refractario incorrecta" << endl;
+        }
+    } catch (...) {
+        cout << "[FAIL] Prueba 23: Excepción inesperada" << endl;
+    }
+
+    // Prueba 24: Intervalos RR con precisión menor que una muestra a 50 Hz
+    pruebas_totales++;
+    try {
+        // Senoide de 1.2288 Hz a 50 Hz: los picos caen entre muestras (RR real = 0.8138 s)
+        double fs = 50.0, frecuencia = 1.2288;
+        vector<double> senal(1500);
+        for (size_t i = 0; i < senal.size(); i++) senal[i] = sin(2 * PI * frecuencia * i / fs);
+        ResultadosBPM resultados = extraerBPM(senal, fs);
+
+        double rr_real = 1.0 / frecuencia, error_maximo = 0.0;
+        for (double rr : resultados.intervalos_rr_segundos) error_maximo = max(error_maximo, abs(rr - rr_real));
+        bool correcto = resultados.intervalos_rr_segundos.size() >= 30 && error_maximo < 1e-3 &&
+                        resultados.tiempos_picos_segundos.size() == resultados.indices_picos.size();
+
+        if (correcto) {
+            cout << "[OK] Prueba 24: RR interpolado a 50 Hz con error máximo de " << error_maximo * 1000 << " ms" << endl;
+            pruebas_exitosas++;
+        } else {
+            cout << "[FAIL] Prueba 24: Error de RR interpolado de " << error_maximo * 1000 << " ms" << endl;
+        }
+    } catch (...) {
+        cout << "[FAIL] Prueba 24: Excepción inesperada" << endl;
+    }
+
+    // Prueba 25: Estimador espectral con armónicos (la fundamental no es el bin más fuerte)
+    pruebas_totales++;
+    try {
+        // 72 bpm: fundamental de 1.2 Hz más débil que su segundo armónico
+        double fs = 200.0;
+        vector<double> senal(6000);
+        for (size_t i = 0; i < senal.size(); i++) {
+            double t = i / fs;
+            senal[i] = 0.5 * sin(2 * PI * 1.2 * t) + 1.0 * sin(2 * PI * 2.4 * t) + 0.8 * sin(2 * PI * 3.6 * t) +
+                       0.05 * (rand() % 100 / 100.0 - 0.5);
+        }
+        ResultadosBPM resultados = analizarSenal(senal, fs, 0.7, EstimadorBPM::Espectral);
+
+        if (abs(resultados.bpm_promedio - 72.0) < 0.5 && resultados.confianza > 0.5 && resultados.indices_picos.empty()) {
+            cout << "[OK] Prueba 25: Estimador espectral (HPS) da " << resultados.bpm_promedio << " bpm, confianza "
+                 << resultados.confianza << endl;
+            pruebas_exitosas++;
+        } else {
+            cout << "[FAIL] Prueba 25: Estimador espectral dio " << resultados.bpm_promedio << " bpm" << endl;
+        }
+    } catch (...) {
+        cout << "[FAIL] Prueba 25: Excepción inesperada" << endl;
+    }
+
+    // Prueba 26: Autocorrelación con S1/S2 desdoblado
+    pruebas_totales++;
+    try {
+        // 80 bpm a 100 Hz: cada latido con dos pulsos (S1 y S2, 0.3 s después), donde el
+        // detector de picos cuenta ambos y duplica el BPM
+        double fs = 100.0, periodo = 0.75;
+        vector<double> senal(3000);
+        for (size_t i = 0; i < senal.size(); i++) {
+            double fase = fmod(i / fs, periodo);
+            senal[i] = exp(-pow(fase - 0.1, 2) / (2 * 0.02 * 0.02)) + 0.9 * exp(-pow(fase - 0.4, 2) / (2 * 0.02 * 0.02));
+        }
+        EstimacionBPM estimacion = estimarBPMAutocorrelacion(senal, fs);
+        double bpm_picos = extraerBPM(senal, fs, 0.5).bpm_promedio;
+
+        // Wiener-Khinchin frente a la suma directa
+        vector<double> corta(senal.begin(), senal.begin() + 300);
+        vector<double> r = autocorrelacion(corta, 100);
+        double media = accumulate(corta.begin(), corta.end(), 0.0) / corta.size(), directa = 0.0;
+        for (size_t i = 0; i + 75 < corta.size(); i++) directa += (corta[i] - media) * (corta[i + 75] - media);
+
+        if (abs(estimacion.bpm - 80.0) < 0.5 && estimacion.confianza > 0.8 && bpm_picos > 120 && abs(r[75] - directa) < 1e-9) {
+            cout << "[OK] Prueba 26: Autocorrelación da " << estimacion.bpm << " bpm (picos: " << bpm_picos << ")" << endl;
+            pruebas_exitosas++;
+        } else {
+            cout << "[FAIL] Prueba 26: Autocorrelación dio " << estimacion.bpm << " bpm" << endl;
+        }
+    } catch (...) {
+        cout << "[FAIL] Prueba 26: Excepción inesperada" << endl;
+    }
+
+    // Prueba 27: Cepstro de un tren de pulsos, completo y por ventanas
+    pruebas_totales++;
+    try {
+        // Pulsos estrechos cada 0.7 s (85.71 bpm) a 1000 Hz: armónicos separados 1.43 Hz
+        double fs = 1000.0, periodo = 0.7;
+        vector<double> senal(60000);
+        for (size_t i = 0; i < senal.size(); i++) {
+            double fase = fmod(i / fs, periodo);
+            senal[i] = exp(-pow(fase - 0.05, 2) / (2 * 0.01 * 0.01)) + 0.05 * (rand() % 100 / 100.0 - 0.5);
+        }
+        ResultadosBPM completo = analizarSenal(senal, fs, 0.7, EstimadorBPM::Cepstral);
+        vector<EstimacionBPM> ventanas = estimarBPMCepstralVentanas(senal, fs, 10.0, 5.0);
+
+        bool correcto = abs(completo.bpm_promedio - 60.0 / periodo) < 1.0 && completo.confianza > 0 && ventanas.size() == 11;
+        for (const auto& ventana : ventanas)
+            if (abs(ventana.bpm - 60.0 / periodo) > 2.0) correcto = false;
+
+        if (correcto) {
+            cout << "[OK] Prueba 27: Cepstro da " << completo.bpm_promedio << " bpm en " << ventanas.size()
+                 << " ventanas" << endl;
             pruebas_exitosas++;
         } else {
-            cout << "[FAIL] Prueba 3: Señal recuperada difiere del original" << endl;
+            cout << "[FAIL] Prueba 27: Cepstro dio " << completo.bpm_promedio << " bpm" << endl;
         }
     } catch (...) {
-        cout << "[FAIL] Prueba 3: Excepción inesperada" << endl;
+        cout << "[FAIL] Prueba 27: Excepción inesperada" << endl;
     }
 
-    // Prueba 4: Detección de picos con umbral
+    // Prueba 28: Envolvente de Hilbert (desde el espectro y en flujo con FIR)
     pruebas_totales++;
     try {
-        vector<double> senal = {0.1, 0.5, 0.3, 0.8, 0.2, 0.9, 0.1};
-        vector<size_t> picos = detectarPicos(senal, 0.5, 1);
-        if (picos.size() >= 2) {
-            cout << "[OK] Prueba 4: Detector de picos funciona" << endl;
+        // Portadora de 60 Hz modulada a 1.2 Hz: la envolvente es 1 + 0.8 cos(2 pi 1.2 t)
+        double fs = 1000.0;
+        vector<double> senal(20000);
+        auto modulacion = [](double t) { return 1.0 + 0.8 * cos(2 * PI * 1.2 * t); };
+        for (size_t i = 0; i < senal.size(); i++) senal[i] = modulacion(i / fs) * sin(2 * PI * 60 * i / fs);
+
+        SenalDecimada envolvente = envolventeHilbert(obtenerEspectroParaFiltrado(senal), senal.size(), fs);
+        double error_espectro = 0.0;
+        for (size_t i = envolvente.muestras.size() / 4; i < 3 * envolvente.muestras.size() / 4; i++)
+            error_espectro = max(error_espectro, abs(envolvente.muestras[i] - modulacion(i * envolvente.factor / fs)));
+
+        EnvolventeHilbertFIR fir(101);
+        vector<double> envolvente_fir;
+        for (size_t inicio = 0; inicio < senal.size(); inicio += 333)
+            fir.procesarBloque(senal.data() + inicio, min<size_t>(333, senal.size() - inicio), envolvente_fir);
+        double error_fir = 0.0;
+        for (size_t i = 1000; i < envolvente_fir.size(); i++)
+            error_fir = max(error_fir, abs(envolvente_fir[i] - modulacion((i - fir.retardo()) / fs)));
+
+        // Una senoidal de amplitud 1 da envolvente ~1 con retardo impar (63, por defecto) y par (65)
+        vector<double> senoidal(2000);
+        for (size_t i = 0; i < senoidal.size(); i++) senoidal[i] = sin(2 * PI * 60 * i / fs);
+        for (size_t longitud : {63, 65}) {
+            EnvolventeHilbertFIR fir_senoidal(longitud);
+            vector<double> envolvente_senoidal;
+            fir_senoidal.procesarBloque(senoidal.data(), senoidal.size(), envolvente_senoidal);
+            for (size_t i = 200; i < envolvente_senoidal.size(); i++)
+                error_fir = max(error_fir, abs(envolvente_senoidal[i] - 1.0));
+        }
+
+        // Ráfagas de 60 Hz a 72 bpm: la envolvente da un pico por latido
+        double bpm = analizarSenal(senal, fs, 0.7, EstimadorBPM::Envolvente).bpm_promedio;
+
+        if (error_espectro < 0.02 && error_fir < 0.05 && envolvente_fir.size() == senal.size() && abs(bpm - 72.0) < 1.0) {
+            cout << "[OK] Prueba 28: Envolvente de Hilbert (error " << error_espectro << ", FIR " << error_fir
+                 << ", " << bpm << " bpm)" << endl;
             pruebas_exitosas++;
         } else {
-            cout << "[FAIL] Prueba 4: No detectó picos esperados" << endl;
+            cout << "[FAIL] Prueba 28: Envolvente de Hilbert con error " << error_espectro << " / " << error_fir
+                 << ", " << bpm << " bpm" << endl;
         }
     } catch (...) {
-        cout << "[FAIL] Prueba 4: Excepción inesperada" << endl;
+        cout << "[FAIL] Prueba 28: Excepción inesperada" << endl;
     }
 
-    // Prueba 5: Cálculo de BPM válido
+    // Prueba 29: Serie de BPM por ventanas deslizantes
     pruebas_totales++;
     try {
-        vector<double> senal(1000, 0.0);
-        double fs = 1000.0;
-        for (int i = 0; i < 10; i++) {
-            int pos = i * 100;
-            if (pos < (int)senal.size()) senal[pos] = 1.0;
+        // 20 s a 60 bpm y 20 s a 120 bpm
+        vector<double> latidos;
+        for (double t = 0.0; t < 20.0; t += 1.0) latidos.push_back(t);
+        for (double t = 20.0; t < 40.0; t += 0.5) latidos.push_back(t);
+        vector<PuntoSerieBPM> serie = serieBPM(latidos, 0.0, 40.0);
+
+        // En flujo, sobre una senoidal de 1.2 Hz ya filtrada
+        double fs = 100.0;
+        vector<double> senal(3000);
+        for (size_t i = 0; i < senal.size(); i++) senal[i] = sin(2 * PI * 1.2 * i / fs);
+        vector<PuntoSerieBPM> serie_en_linea = serieBPMEnLinea(senal, fs);
+
+        // Audio sin filtrar a 8 kHz (pulsos a 72 bpm) en bloques irregulares, como llega un flujo desde el segundo 5
+        double fs_audio = 8000.0;
+        vector<double> audio(static_cast<size_t>(30 * fs_audio));
+        for (size_t i = 0; i < audio.size(); i++) {
+            double fase = fmod(i / fs_audio, 60.0 / 72.0);
+            audio[i] = exp(-pow(fase - 0.1, 2) / (2 * 0.02 * 0.02)) + 0.05 * (rand() % 100 / 100.0 - 0.5);
         }
-        ResultadosBPM resultado = extraerBPM(senal, fs, 0.5, 50);
-        if (resultado.bpm_promedio > 0 && resultado.bpm_promedio < 200) {
-            cout << "[OK] Prueba 5: Cálculo de BPM genera valor válido" << endl;
+        SerieBPMEnFlujo en_flujo(fs_audio, 5.0);
+        vector<PuntoSerieBPM> serie_flujo;
+        for (size_t inicio = 0; inicio < audio.size(); inicio += 777)
+            en_flujo.procesarBloque(audio.data() + inicio, min<size_t>(777, audio.size() - inicio), serie_flujo);
+        en_flujo.finalizar(serie_flujo);
+
+        bool correcto = serie.size() == 31 && abs(serie.front().bpm - 60.0) < 1e-9 &&
+                        abs(serie.back().bpm - 120.0) < 1e-9 && serie_en_linea.size() == 21 &&
+                        serie_flujo.size() == 21 && abs(serie_flujo.front().tiempo_segundos - 15.0) < 1e-9;
+        // El detector aprende el umbral en los 2 primeros segundos: se miran las ventanas posteriores
+        for (const auto& punto : serie_en_linea)
+            if (punto.tiempo_segundos >= 15.0) correcto = correcto && abs(punto.bpm - 72.0) < 0.5;
+        for (const auto& punto : serie_flujo)
+            if (punto.tiempo_segundos >= 20.0) correcto = correcto && abs(punto.bpm - 72.0) < 0.5;
+        if (correcto) {
+            cout << "[OK] Prueba 29: Serie de BPM (" << serie.size() << " ventanas, "
+                 << serie.front().bpm << " -> " << serie.back().bpm << " bpm)" << endl;
             pruebas_exitosas++;
         } else {
-            cout << "[FAIL] Prueba 5: BPM fuera de rango esperado" << endl;
+            cout << "[FAIL] Prueba 29: Serie de BPM con " << serie.size() << " / " << serie_en_linea.size()
+                 << " ventanas" << endl;
         }
     } catch (...) {
-        cout << "[FAIL] Prueba 5: Excepción inesperada" << endl;
+        cout << "[FAIL] Prueba 29: Excepción inesperada" << endl;
     }
 
-    // Prueba 6: Detección de bradicardia
+    // Prueba 30: VFC deslizante frente al cálculo directo de cada ventana
     pruebas_totales++;
     try {
-        ResultadosBPM datos_bradi;
-        datos_bradi.bpm_promedio = 50.0;
-        datos_bradi.intervalos_rr_segundos = {1.2, 1.2, 1.2};
-        Anomalias resultado = detectarAnomalias(datos_bradi);
-        if (resultado.bradicardia) {
-            cout << "[OK] Prueba 6: Detecta bradicardia (BPM < 60)" << endl;
+        vector<double> rr(2000);
+        unsigned int estado = 12345;
+        for (double& intervalo : rr) {
+            estado = estado * 1103515245u + 12345u;
+            intervalo = 0.6 + 0.5 * ((estado >> 8) & 0xFFFF) / 65535.0;
+        }
+
+        double ventana = 30.0;
+        VFCDeslizante vfc(ventana);
+        double error = 0.0;
+        size_t desde = 0;
+        double duracion = 0.0;
+        for (size_t i = 0; i < rr.size(); i++) {
+            vfc.agregarIntervalo(rr[i]);
+            duracion += rr[i];
+            while (i > desde && duracion > ventana) duracion -= rr[desde++];
+
+            // Dos pasadas sobre la ventana, como el cálculo original de SDNN
+            size_t n = i + 1 - desde;
+            double media = accumulate(rr.begin() + desde, rr.begin() + i + 1, 0.0) / n;
+            double varianza = 0.0, cuadrados = 0.0;
+            size_t mayores = 0;
+            for (size_t j = desde; j <= i; j++) varianza += (rr[j] - media) * (rr[j] - media);
+            for (size_t j = desde + 1; j <= i; j++) {
+                cuadrados += (rr[j] - rr[j - 1]) * (rr[j] - rr[j - 1]);
+                if (abs(rr[j] - rr[j - 1]) > 0.05) mayores++;
+            }
+            MetricasVFC m = vfc.metricas();
+            error = max({error, abs(m.sdnn - sqrt(varianza / n)), abs(m.rr_medio - media),
+                         abs(m.rr_min - *min_element(rr.begin() + desde, rr.begin() + i + 1)),
+                         abs(m.rr_max - *max_element(rr.begin() + desde, rr.begin() + i + 1))});
+            if (n > 1) error = max({error, abs(m.rmssd - sqrt(cuadrados / (n - 1))),
+                                    abs(m.pnn50 - static_cast<double>(mayores) / (n - 1))});
+            if (m.intervalos != n) error = 1.0;
+        }
+
+        // Un cambio de ritmo regular a irregular se detecta en la ventana en curso
+        vector<double> latidos;
+        double t = 0.0;
+        for (int i = 0; i < 60; i++) latidos.push_back(t += 0.8);
+        for (int i = 0; i < 60; i++) latidos.push_back(t += (i % 2 ? 0.6 : 1.0));
+        vector<PuntoSerieVFC> serie = serieVFC(latidos);
+        bool regular = !detectarAnomalias(75.0, serie[40].metricas).irregularidad;
+        bool irregular = detectarAnomalias(75.0, serie.back().metricas).irregularidad;
+
+        if (error < 1e-9 && regular && irregular && serie.size() == latidos.size() - 1) {
+            cout << "[OK] Prueba 30: VFC deslizante (error máximo " << error << ")" << endl;
             pruebas_exitosas++;
         } else {
-            cout << "[FAIL] Prueba 6: No detectó bradicardia" << endl;
+            cout << "[FAIL] Prueba 30: VFC deslizante con error " << error << ", regular " << regular
+                 << ", irregular " << irregular << endl;
         }
     } catch (...) {
-        cout << "[FAIL] Prueba 6: Excepción inesperada" << endl;
+        cout << "[FAIL] Prueba 30: Excepción inesperada" << endl;
     }
 
-    // Prueba 7: Detección de taquicardia
+    // Prueba 31: LF y HF con Lomb-Scargle rápido
     pruebas_totales++;
     try {
-        ResultadosBPM datos_taqui;
-        datos_taqui.bpm_promedio = 120.0;
-        datos_taqui.intervalos_rr_segundos = {0.5, 0.5, 0.5};
-        Anomalias resultado = detectarAnomalias(datos_taqui);
-        if (resultado.taquicardia) {
-            cout << "[OK] Prueba 7: Detecta taquicardia (BPM > 100)" << endl;
+        // RR de 0.8 s modulado a 0.1 Hz (30 ms) y 0.25 Hz (20 ms): LF = 450 ms², HF = 200 ms²
+        auto periodo = [](double t) { return 0.8 + 0.03 * sin(2 * PI * 0.1 * t) + 0.02 * sin(2 * PI * 0.25 * t); };
+        vector<double> latidos = {0.0};
+        while (latidos.back() < 300.0) latidos.push_back(latidos.back() + periodo(latidos.back()));
+        vector<double> tiempos(latidos.begin() + 1, latidos.end()), rr(tiempos.size());
+        for (size_t i = 0; i < rr.size(); i++) rr[i] = latidos[i + 1] - latidos[i];
+
+        PeriodogramaLomb rapido = lombScargleRapido(tiempos, rr, BANDA_HF_MAX);
+        PeriodogramaLomb directo = lombScargleDirecto(tiempos, rr, BANDA_HF_MAX);
+        double error = 0.0, maximo = 0.0;
+        for (size_t k = 0; k < directo.densidad.size(); k++) {
+            error = max(error, abs(rapido.densidad[k] - directo.densidad[k]));
+            maximo = max(maximo, directo.densidad[k]);
+        }
+
+        ResultadosBPM resultados;
+        resultados.indices_picos.resize(latidos.size());
+        resultados.tiempos_picos_segundos = latidos;
+        calcularIntervalosRR(resultados, 1000.0);
+        const PotenciaVFC& potencia = resultados.potencia_vfc;
+        vector<PuntoSerieLFHF> serie = serieLFHF(latidos);
+
+        bool correcto = rapido.densidad.size() == directo.densidad.size() && error < 1e-3 * maximo &&
+                        potencia.valida && abs(potencia.lf - 450.0) < 25.0 && abs(potencia.hf - 200.0) < 15.0 &&
+                        serie.size() == 7;
+        for (const auto& punto : serie)
+            correcto = correcto && punto.potencia.valida && abs(punto.potencia.lf_hf - 2.25) < 0.25;
+
+        // La ventana deslizante coincide con el periodograma recalculado sobre la misma ventana
+        double diferencia = 0.0;
+        for (const auto& punto : serie) {
+            vector<double> t_ventana, rr_ventana;
+            for (size_t i = 0; i < tiempos.size(); i++) {
+                if (tiempos[i] >= punto.tiempo_segundos - 120.0 && tiempos[i] < punto.tiempo_segundos) {
+                    t_ventana.push_back(tiempos[i]);
+                    rr_ventana.push_back(rr[i]);
+                }
+            }
+            PotenciaVFC recalculada = potenciaVFC(t_ventana, rr_ventana);
+            diferencia = max({diferencia, abs(punto.potencia.lf / recalculada.lf - 1), abs(punto.potencia.hf / recalculada.hf - 1)});
+        }
+        correcto = correcto && diferencia < 0.01;
+        if (correcto) {
+            cout << "[OK] Prueba 31: LF/HF por Lomb-Scargle (LF " << potencia.lf << " ms², HF " << potencia.hf
+                 << " ms², error relativo " << error / maximo << ")" << endl;
             pruebas_exitosas++;
         } else {
-            cout << "[FAIL] Prueba 7: No detectó taquicardia" << endl;
+            cout << "[FAIL] Prueba 31: LF " << potencia.lf << " ms², HF " << potencia.hf << ", error relativo "
+                 << error / maximo << ", " << serie.size() << " ventanas" << endl;
         }
     } catch (...) {
-        cout << "[FAIL] Prueba 7: Excepción inesperada" << endl;
+        cout << "[FAIL] Prueba 31: Excepción inesperada" << endl;
     }
 
-    // Prueba 8: Siguiente potencia de 2
+    // Prueba 32: Motor de reglas de anomalías
     pruebas_totales++;
     try {
-        if (siguiente_potencia2(100) == 128 && siguiente_potencia2(256) == 256) {
-            cout << "[OK] Prueba 8: Cálculo de siguiente potencia de 2 correcto" << endl;
+        const MotorReglas& reglas = reglasPorDefecto();
+        MetricasAnomalias metricas;
+        bool insuficiente = reglas.evaluar(metricas).tiene(CodigoAlerta::DatosInsuficientes);
+
+        // Sin intervalos RR (estimadores espectrales) las reglas de BPM se evalúan igual
+        metricas.bpm = 120.0;
+        ResultadoAlertas sin_intervalos = reglas.evaluar(metricas);
+        bool solo_bpm = sin_intervalos.codigos.count() == 1 && sin_intervalos.tiene(CodigoAlerta::Taquicardia);
+        metricas.bpm = 50.0;
+        metricas.vfc = calcularVFC({1.2, 1.2, 1.2});
+        ResultadoAlertas bradicardia = reglas.evaluar(metricas, 12.5);
+        metricas.bpm = 75.0;
+        metricas.vfc = calcularVFC({0.6, 1.0, 0.7, 1.2, 0.5});
+        ResultadoAlertas irregular = reglas.evaluar(metricas);
+
+        // Umbrales propios desde un archivo; la regla de LF/HF no se dispara sin potencia válida
+        const char* ruta_temporal = "prueba_reglas.tmp.txt";
+        {
+            ofstream archivo(ruta_temporal);
+            archivo << "# umbrales de adultos entrenados\nbradicardia bpm < 45\n\nirregularidad rmssd > 0.6\n"
+                    << "irregularidad lf_hf > 4  # simpático\n";
+        }
+        MotorReglas propias = MotorReglas::desdeArchivo(ruta_temporal);
+        {
+            ofstream archivo(ruta_temporal);
+            archivo << "bradicardia latidos < 45\n";
+        }
+        bool rechaza_invalida = false;
+        try {
+            MotorReglas::desdeArchivo(ruta_temporal);
+        } catch (runtime_error&) {
+            rechaza_invalida = true;
+        }
+        remove(ruta_temporal);
+        ResultadoAlertas con_propias = propias.evaluar(metricas);
+        metricas.bpm = 50.0;
+        bool sin_bradicardia = propias.evaluar(metricas).codigos.none();
+        metricas.potencia.valida = true;
+        metricas.potencia.lf_hf = 5.0;
+        bool simpatico = propias.evaluar(metricas).tiene(CodigoAlerta::Irregularidad);
+
+        bool correcto = insuficiente && solo_bpm && bradicardia.codigos.count() == 1 && bradicardia.tiene(CodigoAlerta::Bradicardia) &&
+                        bradicardia.tiempo_segundos == 12.5 && irregular.codigos.count() == 1 &&
+                        irregular.tiene(CodigoAlerta::Irregularidad) && propias.cantidad() == 3 &&
+                        con_propias.codigos.none() && sin_bradicardia && simpatico && rechaza_invalida &&
+                        reglas.describir(irregular) == vector<string>{"Latido irregular (SDNN > 0.10s)"} &&
+                        propias.describir(propias.evaluar(metricas)) ==
+                            vector<string>{"Latido irregular (LF/HF > 4)"};
+        if (correcto) {
+            cout << "[OK] Prueba 32: Motor de reglas (" << reglas.describir(irregular)[0] << ")" << endl;
             pruebas_exitosas++;
         } else {
-            cout << "[FAIL] Prueba 8: Cálculo incorrecto de potencia de 2" << endl;
+            cout << "[FAIL] Prueba 32: Motor de reglas con resultados inesperados" << endl;
         }
     } catch (...) {
-        cout << "[FAIL] Prueba 8: Excepción inesperada" << endl;
+        cout << "[FAIL] Prueba 32: Excepción inesperada" << endl;
     }
 
     cout << "\n=== RESUMEN PRUEBAS UNITARIAS ===" << endl;
@@ -686,12 +5138,653 @@ void analisisExperimental() {
         cout << n << "\t\t" << duracion_ms << "\t\t" << ratio << endl;
     }
     
+    // Experimento 5: Decodificación según formato de entrada
+    cout << "\nExperimento 5: Decodificación según formato del WAV" << endl;
+    cout << "Midiendo lectura completa de 10 s a 44100 Hz por formato...\n" << endl;
+
+    cout << "Formato\t\tTiempo (ms)\tMmuestras/s\tError máximo" << endl;
+    cout << "-------\t\t-----------\t-----------\t------------" << endl;
+
+    struct FormatoPrueba {
+        string nombre;
+        drwav_uint32 formato_wav;
+        drwav_uint32 bits;
+    };
+    vector<FormatoPrueba> formatos = {
+        {"PCM 16 bits", DR_WAVE_FORMAT_PCM, 16},
+        {"PCM 24 bits", DR_WAVE_FORMAT_PCM, 24},
+        {"PCM 32 bits", DR_WAVE_FORMAT_PCM, 32},
+        {"Float 32 bits", DR_WAVE_FORMAT_IEEE_FLOAT, 32},
+        {"A-law 8 bits", DR_WAVE_FORMAT_ALAW, 8},
+        {"mu-law 8 bits", DR_WAVE_FORMAT_MULAW, 8},
+        {"IMA ADPCM 4 bits", DR_WAVE_FORMAT_DVI_ADPCM, 4}
+    };
+
+    vector<double> senal_formato(441000);
+    for (size_t i = 0; i < senal_formato.size(); i++) {
+        senal_formato[i] = 0.5 * sin(2 * PI * 1.2 * i / 44100.0) + 0.3 * sin(2 * PI * 60.0 * i / 44100.0);
+    }
+
+    for (const auto& f : formatos) {
+        const char* ruta_temporal = "experimento_formato.tmp.wav";
+        escribirWavFormato(ruta_temporal, senal_formato, 44100, f.formato_wav, f.bits);
+
+        // Solo se cronometra la decodificación
+        size_t total = 0;
+        auto inicio = std::chrono::high_resolution_clock::now();
+        {
+            WavStream flujo(ruta_temporal);
+            vector<double> bloque;
+            while (flujo.siguienteBloque(bloque)) total += bloque.size();
+        }
+        auto fin = std::chrono::high_resolution_clock::now();
+
+        // La verificación se hace en una segunda lectura, fuera del tiempo medido
+        double error_maximo = 0.0;
+        {
+            WavStream flujo(ruta_temporal);
+            vector<double> bloque;
+            size_t leidas = 0;
+            // dr_wav cuenta el relleno del último bloque ADPCM como muestras; se ignora
+            while (flujo.siguienteBloque(bloque)) {
+                for (size_t i = 0; i < bloque.size() && leidas + i < senal_formato.size(); i++) {
+                    error_maximo = max(error_maximo, abs(bloque[i] - senal_formato[leidas + i]));
+                }
+                leidas += bloque.size();
+            }
+        }
+        remove(ruta_temporal);
+
+        double duracion_ms = std::chrono::duration_cast<std::chrono::microseconds>(fin - inicio).count() / 1000.0;
+        cout << f.nombre << "\t" << duracion_ms << "\t\t" << (total / 1000.0) / duracion_ms
+             << "\t\t" << error_maximo << endl;
+    }
+
+    // Experimento 6: Decodificación en serie vs en paralelo
+    cout << "\nExperimento 6: Decodificación en serie vs paralela por rangos" << endl;
+    cout << "WAV de 24 bits, 60 s a 44100 Hz, " << max(1u, thread::hardware_concurrency()) << " núcleo(s)...\n" << endl;
+    {
+        const char* ruta_temporal = "experimento_paralelo.tmp.wav";
+        vector<double> senal_larga(44100 * 60);
+        for (size_t i = 0; i < senal_larga.size(); i++) {
+            senal_larga[i] = 0.5 * sin(2 * PI * 1.2 * i / 44100.0);
+        }
+        escribirWavFormato(ruta_temporal, senal_larga, 44100, DR_WAVE_FORMAT_PCM, 24);
+
+        auto inicio = std::chrono::high_resolution_clock::now();
+        vector<double> serie = decodificarWavParalelo(ruta_temporal, 1);
+        auto medio = std::chrono::high_resolution_clock::now();
+        vector<double> paralelo = decodificarWavParalelo(ruta_temporal, 0);
+        auto fin = std::chrono::high_resolution_clock::now();
+        remove(ruta_temporal);
+
+        double ms_serie = std::chrono::duration_cast<std::chrono::microseconds>(medio - inicio).count() / 1000.0;
+        double ms_paralelo = std::chrono::duration_cast<std::chrono::microseconds>(fin - medio).count() / 1000.0;
+        cout << "Serie: " << ms_serie << " ms" << endl;
+        cout << "Paralelo: " << ms_paralelo << " ms (aceleración " << ms_serie / ms_paralelo << "x)" << endl;
+        cout << "Resultados idénticos: " << (serie == paralelo ? "Sí" : "No") << endl;
+    }
+
+    // Experimento 7: Lectura y análisis de lotes con stdio vs io_uring
+    cout << "\nExperimento 7: Lote de archivos, stdio en serie vs io_uring con trabajador" << endl;
+    cout << "64 archivos WAV de 5 s a 44100 Hz, lectura y decodificación, en caché y fuera de ella...\n" << endl;
+    {
+        vector<string> rutas;
+        vector<int16_t> muestras(44100 * 5);
+        for (size_t i = 0; i < muestras.size(); i++) {
+            muestras[i] = static_cast<int16_t>(10000 * sin(2 * PI * 1.2 * i / 44100.0));
+        }
+        for (size_t k = 0; k < 64; k++) {
+            rutas.push_back("experimento_lote_" + to_string(k) + ".tmp.wav");
+            escribirWavPrueba(rutas.back().c_str(), muestras, 44100);
+        }
+
+        // Saca los archivos de la caché de páginas para medir lecturas reales del disco
+        auto expulsarDeCache = [&]() {
+#ifdef __linux__
+            for (const auto& ruta : rutas) {
+                int fd = open(ruta.c_str(), O_RDONLY);
+                if (fd < 0) continue;
+                fdatasync(fd);
+                posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+                close(fd);
+            }
+            return true;
+#else
+            return false;
+#endif
+        };
+
+        // Trabajo por archivo: decodificar y reducir las muestras
+        auto analizarFlujo = [](WavStream& flujo) {
+            vector<double> bloque;
+            double suma = 0.0;
+            while (flujo.siguienteBloque(bloque)) suma = accumulate(bloque.begin(), bloque.end(), suma);
+            return suma;
+        };
+
+        auto medirStdio = [&](double& suma) {
+            auto inicio = std::chrono::high_resolution_clock::now();
+            for (const auto& ruta : rutas) {
+                WavStream flujo(ruta);
+                suma += analizarFlujo(flujo);
+            }
+            auto fin = std::chrono::high_resolution_clock::now();
+            return std::chrono::duration_cast<std::chrono::microseconds>(fin - inicio).count() / 1000.0;
+        };
+
+        LectorLoteUring lector(16);
+        auto medirUring = [&](double& suma) {
+            auto inicio = std::chrono::high_resolution_clock::now();
+            lector.leer(rutas, [&](size_t, const vector<uint8_t>& datos, const string& error) {
+                if (!error.empty()) return;
+                WavStream flujo(BytesEnMemoria{datos.data(), datos.size()});
+                suma += analizarFlujo(flujo);
+            });
+            auto fin = std::chrono::high_resolution_clock::now();
+            return std::chrono::duration_cast<std::chrono::microseconds>(fin - inicio).count() / 1000.0;
+        };
+
+        string nombre_uring = lector.usaIoUring() ? "io_uring (prof. 16)" : "respaldo stdio";
+        cout << "Caché\t\tLector\t\t\tTiempo (ms)\tArchivos/s" << endl;
+        cout << "-----\t\t------\t\t\t-----------\t----------" << endl;
+        bool iguales = true;
+        for (bool en_frio : {false, true}) {
+            if (en_frio && !expulsarDeCache()) break;
+            double suma_stdio = 0.0, suma_uring = 0.0;
+            double ms_stdio = medirStdio(suma_stdio);
+            if (en_frio) expulsarDeCache();
+            double ms_uring = medirUring(suma_uring);
+            iguales = iguales && suma_stdio == suma_uring;
+
+            const char* cache = en_frio ? "fría\t" : "caliente";
+            cout << cache << "\tstdio en serie\t\t" << ms_stdio << "\t\t" << rutas.size() / (ms_stdio / 1000.0) << endl;
+            cout << cache << "\t" << nombre_uring << "\t" << ms_uring << "\t\t" << rutas.size() / (ms_uring / 1000.0) << endl;
+        }
+        for (const auto& ruta : rutas) remove(ruta.c_str());
+        cout << "Resultados idénticos: " << (iguales ? "Sí" : "No") << endl;
+    }
+
+    // Experimento 8: Rendimiento del detector de picos
+    cout << "\nExperimento 8: Detección de picos sobre señales largas" << endl;
+    cout << "Señal de 1e7 muestras (latidos a 1.2 Hz con ruido, fs = 1000 Hz)...\n" << endl;
+    {
+        vector<double> senal(10000000);
+        for (size_t i = 0; i < senal.size(); i++) {
+            senal[i] = sin(2 * PI * 1.2 * i / 1000.0) + 0.1 * (rand() % 100 / 100.0 - 0.5);
+        }
+
+        unsigned int nucleos = max(1u, thread::hardware_concurrency());
+        auto inicio = std::chrono::high_resolution_clock::now();
+        vector<size_t> serie = detectarPicos(senal, 0.7, 200, 1);
+        auto medio = std::chrono::high_resolution_clock::now();
+        vector<size_t> paralelo = detectarPicos(senal, 0.7, 200, nucleos);
+        auto fin = std::chrono::high_resolution_clock::now();
+
+        double ms_serie = std::chrono::duration_cast<std::chrono::microseconds>(medio - inicio).count() / 1000.0;
+        double ms_paralelo = std::chrono::duration_cast<std::chrono::microseconds>(fin - medio).count() / 1000.0;
+        double mb = senal.size() * sizeof(double) / (1024.0 * 1024.0);
+        cout << "Picos: " << serie.size() << endl;
+        cout << "1 hilo: " << ms_serie << " ms, " << mb / (ms_serie / 1000.0) << " MB/s" << endl;
+        cout << nucleos << " hilo(s): " << ms_paralelo << " ms, " << mb / (ms_paralelo / 1000.0) << " MB/s" << endl;
+        cout << "Resultados idénticos: " << (serie == paralelo ? "Sí" : "No") << endl;
+    }
+
+    // Experimento 9: Estimador espectral frente a detección de picos
+    cout << "\nExperimento 9: Estimador espectral (sin IFFT) vs detección de picos" << endl;
+    cout << "20 señales de 60 s a 500 Hz con BPM entre 50 y 150, armónicos y ruido...\n" << endl;
+    {
+        srand(9);   // señales fijas: no dependen de cuántos números aleatorios consumieron las pruebas
+        const size_t num_senales = 20;
+        double fs = 500.0;
+        vector<vector<double>> senales(num_senales, vector<double>(30000));
+        for (auto& senal : senales) {
+            double f = (50 + rand() % 101) / 60.0;
+            for (size_t i = 0; i < senal.size(); i++) {
+                double t = i / fs;
+                senal[i] = sin(2 * PI * f * t) + 0.4 * sin(2 * PI * 2 * f * t) + 0.3 * (rand() % 100 / 100.0 - 0.5);
+            }
+        }
+
+        vector<double> bpm_picos(num_senales), bpm_espectral(num_senales);
+        auto inicio = std::chrono::high_resolution_clock::now();
+        for (size_t k = 0; k < num_senales; k++) bpm_picos[k] = analizarSenal(senales[k], fs).bpm_promedio;
+        auto medio = std::chrono::high_resolution_clock::now();
+        for (size_t k = 0; k < num_senales; k++)
+            bpm_espectral[k] = analizarSenal(senales[k], fs, 0.7, EstimadorBPM::Espectral).bpm_promedio;
+        auto fin = std::chrono::high_resolution_clock::now();
+
+        size_t coinciden = 0;
+        double diferencia_maxima = 0.0;
+        for (size_t k = 0; k < num_senales; k++) {
+            double diferencia = abs(bpm_picos[k] - bpm_espectral[k]);
+            diferencia_maxima = max(diferencia_maxima, diferencia);
+            if (diferencia < 2.0) coinciden++;
+        }
+        double ms_picos = std::chrono::duration_cast<std::chrono::microseconds>(medio - inicio).count() / 1000.0;
+        double ms_espectral = std::chrono::duration_cast<std::chrono::microseconds>(fin - medio).count() / 1000.0;
+        cout << "Picos: " << ms_picos << " ms, espectral: " << ms_espectral << " ms (x"
+             << ms_picos / ms_espectral << ")" << endl;
+        cout << "Coinciden (< 2 bpm): " << coinciden << "/" << num_senales
+             << ", diferencia máxima: " << diferencia_maxima << " bpm" << endl;
+    }
+
+    // Experimento 10: Lomb-Scargle rápido frente al directo
+    cout << "\nExperimento 10: Lomb-Scargle rápido (extirpolación + FFT) vs directo" << endl;
+    cout << "Serie RR de 1 h (unos 4500 latidos) hasta 0.4 Hz...\n" << endl;
+    {
+        vector<double> tiempos, rr;
+        double t = 0.0;
+        while (t < 3600.0) {
+            double intervalo = 0.8 + 0.03 * sin(2 * PI * 0.1 * t) + 0.02 * (rand() % 100 / 100.0 - 0.5);
+            t += intervalo;
+            tiempos.push_back(t);
+            rr.push_back(intervalo);
+        }
+
+        auto inicio = std::chrono::high_resolution_clock::now();
+        PeriodogramaLomb directo = lombScargleDirecto(tiempos, rr, BANDA_HF_MAX);
+        auto medio = std::chrono::high_resolution_clock::now();
+        PeriodogramaLomb rapido = lombScargleRapido(tiempos, rr, BANDA_HF_MAX);
+        auto fin = std::chrono::high_resolution_clock::now();
+
+        double error = 0.0, maximo = 0.0;
+        for (size_t k = 0; k < directo.densidad.size(); k++) {
+            error = max(error, abs(rapido.densidad[k] - directo.densidad[k]));
+            maximo = max(maximo, directo.densidad[k]);
+        }
+        double ms_directo = std::chrono::duration_cast<std::chrono::microseconds>(medio - inicio).count() / 1000.0;
+        double ms_rapido = std::chrono::duration_cast<std::chrono::microseconds>(fin - medio).count() / 1000.0;
+        cout << tiempos.size() << " latidos, " << directo.densidad.size() << " frecuencias" << endl;
+        cout << "Directo: " << ms_directo << " ms, rápido: " << ms_rapido << " ms (x" << ms_directo / ms_rapido << ")"
+             << endl;
+        cout << "Error relativo máximo: " << error / maximo << endl;
+    }
+
+    // Experimento 11: Motor de reglas frente a la detección con textos
+    cout << "\nExperimento 11: Evaluación de anomalías con códigos vs con textos" << endl;
+    cout << "1000000 evaluaciones sobre métricas ya calculadas...\n" << endl;
+    {
+        const size_t evaluaciones = 1000000;
+        const MotorReglas& reglas = reglasPorDefecto();
+        MetricasAnomalias metricas;
+        metricas.vfc = calcularVFC({0.6, 1.0, 0.7, 1.2, 0.5});
+
+        size_t activas_codigos = 0, activas_textos = 0;
+        auto inicio = std::chrono::high_resolution_clock::now();
+        for (size_t k = 0; k < evaluaciones; k++) {
+            metricas.bpm = 40.0 + k % 100;
+            activas_codigos += reglas.evaluar(metricas, k * 0.001).codigos.count();
+        }
+        auto medio = std::chrono::high_resolution_clock::now();
+        for (size_t k = 0; k < evaluaciones; k++) {
+            Anomalias anomalias = detectarAnomalias(40.0 + k % 100, metricas.vfc);
+            activas_textos += anomalias.bradicardia + anomalias.taquicardia + anomalias.irregularidad;
+        }
+        auto fin = std::chrono::high_resolution_clock::now();
+
+        double ms_codigos = std::chrono::duration_cast<std::chrono::microseconds>(medio - inicio).count() / 1000.0;
+        double ms_textos = std::chrono::duration_cast<std::chrono::microseconds>(fin - medio).count() / 1000.0;
+        cout << "Códigos: " << ms_codigos << " ms, textos: " << ms_textos << " ms (x" << ms_textos / ms_codigos << ")"
+             << endl;
+        cout << "Mismas alertas: " << (activas_codigos == activas_textos ? "Sí" : "No") << endl;
+    }
+
     cout << "\n[OK] Análisis experimental completado" << endl;
 }
 
 
+// Muestra los resultados de BPM y el diagnóstico de anomalías
+void mostrarResultados(const ResultadosBPM& resultados, const MotorReglas& reglas = reglasPorDefecto()) {
+    cout << "\n--- RESULTADOS ---" << endl;
+    cout << "BPM promedio: " << resultados.bpm_promedio << endl;
+    if (resultados.confianza >= 0) cout << "Confianza: " << resultados.confianza << endl;
+    cout << "Picos detectados: " << resultados.indices_picos.size() << endl;
+    cout << "Intervalos RR: " << resultados.intervalos_rr_segundos.size() << endl;
+    MetricasVFC vfc = calcularVFC(resultados.intervalos_rr_segundos);
+    if (vfc.intervalos > 1) {
+        cout << "SDNN: " << vfc.sdnn * 1000 << " ms, RMSSD: " << vfc.rmssd * 1000 << " ms, pNN50: "
+             << vfc.pnn50 * 100 << " %" << endl;
+        cout << "RR mínimo/máximo: " << vfc.rr_min << " / " << vfc.rr_max << " s" << endl;
+    }
+    if (resultados.potencia_vfc.valida) {
+        cout << "LF: " << resultados.potencia_vfc.lf << " ms², HF: " << resultados.potencia_vfc.hf
+             << " ms², LF/HF: " << resultados.potencia_vfc.lf_hf << endl;
+    }
+
+    cout << "\nDetectando anomalías..." << endl;
+    MetricasAnomalias metricas;
+    metricas.bpm = resultados.bpm_promedio;
+    metricas.vfc = vfc;
+    metricas.potencia = resultados.potencia_vfc;
+    ResultadoAlertas alertas = reglas.evaluar(metricas);
+
+    cout << "\n--- DIAGNÓSTICO ---" << endl;
+    for (const auto& alerta : reglas.describir(alertas)) {
+        cout << "• " << alerta << endl;
+    }
+}
+
+// Muestra el BPM de cada canal, el consenso y el diagnóstico del canal representativo
+void mostrarResultadosMulticanal(const ResultadosMulticanal& multicanal, const MotorReglas& reglas = reglasPorDefecto()) {
+    cout << "\n--- RESULTADOS POR CANAL ---" << endl;
+    for (size_t c = 0; c < multicanal.por_canal.size(); c++) {
+        cout << "Canal " << c + 1 << ": " << multicanal.por_canal[c].bpm_promedio << " bpm, "
+             << multicanal.por_canal[c].indices_picos.size() << " picos" << endl;
+    }
+    cout << "BPM de consenso: " << multicanal.bpm_consenso << endl;
+
+    cout << "\nCanal representativo: " << multicanal.canal_representativo + 1 << endl;
+    mostrarResultados(multicanal.por_canal[multicanal.canal_representativo], reglas);
+}
+
+/*
+Verificación cruzada con el cepstro: estima el BPM por ventanas de 10 s cada 5 s
+con estimarBPMCepstralVentanas y lo compara con el de los picos que caen en cada
+ventana (intervalo medio entre el primero y el último). Marca las ventanas que
+difieren más de 'tolerancia_bpm' o en las que los picos no dan un BPM; sirve para
+ver en qué tramos falla uno de los dos métodos. 'inicio_segundos' es el instante
+de la primera muestra de la señal, el mismo origen que los tiempos de los picos.
+*/
+void verificarConCepstro(const vector<double>& senal, double frecuencia_muestreo, const ResultadosBPM& resultados,
+                         double inicio_segundos = 0.0, double tolerancia_bpm = 5.0) {
+    const double ventana = 10.0, salto = 5.0;
+    vector<EstimacionBPM> estimaciones = estimarBPMCepstralVentanas(senal, frecuencia_muestreo, ventana, salto);
+    cout << "\n--- VERIFICACIÓN CEPSTRAL (ventanas de " << ventana << " s cada " << salto << " s) ---" << endl;
+    if (estimaciones.empty()) {
+        cout << "La señal es más corta que una ventana" << endl;
+        return;
+    }
+
+    const vector<double>& tiempos = resultados.tiempos_picos_segundos;
+    size_t discrepancias = 0;
+    cout << "Ventana (s)\tPicos (bpm)\tCepstro (bpm)" << endl;
+    for (size_t w = 0; w < estimaciones.size(); w++) {
+        double desde = inicio_segundos + w * salto, hasta = desde + ventana;
+        auto primero = lower_bound(tiempos.begin(), tiempos.end(), desde);
+        auto ultimo = lower_bound(tiempos.begin(), tiempos.end(), hasta);
+        double bpm_picos = 0.0;
+        if (ultimo - primero >= 2) bpm_picos = 60.0 * (ultimo - primero - 1) / (*(ultimo - 1) - *primero);
+
+        bool coinciden = bpm_picos > 0 && estimaciones[w].bpm > 0 && abs(bpm_picos - estimaciones[w].bpm) <= tolerancia_bpm;
+        if (!coinciden) discrepancias++;
+        cout << desde << "-" << hasta << "\t" << bpm_picos << "\t\t" << estimaciones[w].bpm
+             << (coinciden ? "" : "\t<- no coinciden") << endl;
+    }
+    cout << "Ventanas que no coinciden: " << discrepancias << "/" << estimaciones.size() << endl;
+}
+
+// Muestra los datos de formato de una grabación
+void mostrarFormato(const Grabacion& grabacion) {
+    cout << "Formato: " << grabacion.frecuencia_muestreo << " Hz, " << grabacion.num_canales
+         << " canal(es), " << grabacion.bits_por_muestra << " bits, "
+         << grabacion.duracion_segundos << " s" << endl;
+}
+
+// Lee un número de segundos de la línea de comandos
+bool leerSegundos(const char* texto, double& valor) {
+    char* fin = nullptr;
+    valor = strtod(texto, &fin);
+    return fin != texto && *fin == '\0' && valor >= 0;
+}
+
+// Indica si la ruta es una FIFO, tubería o dispositivo, que solo se puede leer en secuencia
+bool esFlujoSecuencial(const string& ruta) {
+#ifndef _WIN32
+    struct stat info;
+    if (stat(ruta.c_str(), &info) != 0) return false;
+    return S_ISFIFO(info.st_mode) || S_ISCHR(info.st_mode) || S_ISSOCK(info.st_mode);
+#else
+    (void)ruta;
+    return false;
+#endif
+}
+
+// Una fila de la serie de BPM (se vuelca en el momento, para seguir un flujo en vivo)
+void mostrarPuntoSerieBPM(const PuntoSerieBPM& punto) {
+    cout << punto.tiempo_segundos << "\t" << punto.bpm << "\t" << punto.latidos << endl;
+}
+
+// Muestra la serie de BPM por ventanas
+void mostrarSerieBPM(const vector<PuntoSerieBPM>& serie) {
+    cout << "\n--- SERIE DE BPM ---" << endl;
+    cout << "Tiempo (s)\tBPM\tLatidos" << endl;
+    for (const auto& punto : serie) mostrarPuntoSerieBPM(punto);
+}
+
+// Muestra la serie de VFC (en milisegundos) con la evaluación de la ventana de cada latido
+void mostrarSerieVFC(const vector<PuntoSerieVFC>& serie, const MotorReglas& reglas) {
+    cout << "\n--- SERIE DE VFC ---" << endl;
+    cout << "Tiempo (s)\tRR medio\tSDNN\tRMSSD\tpNN50 (%)\tAlertas" << endl;
+    for (const auto& punto : serie) {
+        const MetricasVFC& m = punto.metricas;
+        MetricasAnomalias metricas;
+        metricas.bpm = 60.0 / m.rr_medio;
+        metricas.vfc = m;
+        ResultadoAlertas alertas = reglas.evaluar(metricas, punto.tiempo_segundos);
+        cout << alertas.tiempo_segundos << "\t" << m.rr_medio * 1000 << "\t" << m.sdnn * 1000 << "\t"
+             << m.rmssd * 1000 << "\t" << m.pnn50 * 100 << "\t";
+        if (alertas.codigos.none()) cout << "-";
+        for (size_t c = 0; c < NUM_CODIGOS_ALERTA; c++)
+            if (alertas.codigos.test(c)) cout << NOMBRES_CODIGOS[c] << " ";
+        cout << endl;
+    }
+}
+
+// Muestra LF y HF por ventanas
+void mostrarSerieLFHF(const vector<PuntoSerieLFHF>& serie) {
+    if (serie.empty()) return;
+    cout << "\n--- SERIE LF/HF ---" << endl;
+    cout << "Tiempo (s)\tLF (ms²)\tHF (ms²)\tLF/HF" << endl;
+    for (const auto& punto : serie) {
+        if (!punto.potencia.valida) continue;
+        cout << punto.tiempo_segundos << "\t" << punto.potencia.lf << "\t" << punto.potencia.hf << "\t"
+             << punto.potencia.lf_hf << endl;
+    }
+}
+
+// Muestra las series de VFC en el tiempo y en frecuencia
+void mostrarSeriesVFC(const vector<double>& tiempos_picos, const MotorReglas& reglas) {
+    mostrarSerieVFC(serieVFC(tiempos_picos), reglas);
+    mostrarSerieLFHF(serieLFHF(tiempos_picos));
+}
+
+// Opciones de análisis elegidas en la línea de comandos
+struct OpcionesAnalisis {
+    double umbral_picos = 0.7;
+    EstimadorBPM estimador = EstimadorBPM::Picos;
+    string ruta_filtrada;            // si no está vacía se guarda ahí la señal filtrada
+    bool serie_bpm = false;          // serie de BPM en ventanas de 10 s cada 1 s
+    bool verificar_cepstro = false;  // compara los picos con el cepstro por ventanas
+    bool serie_vfc = false;          // VFC en ventanas de 30 s por latido y LF/HF en ventanas de 2 min
+    MotorReglas reglas;              // reglas de anomalías, cargadas una vez
+};
+
+// Muestra las series pedidas con --series y --hrv para una señal que dura [inicio, fin) s.
+// Necesitan los instantes de los latidos, que los estimadores espectral, de
+// autocorrelación y cepstral no dan: en ese caso se avisa en lugar de callar
+void mostrarSeries(const vector<double>& tiempos_picos, double inicio, double fin, const OpcionesAnalisis& opciones) {
+    if (!opciones.serie_bpm && !opciones.serie_vfc) return;
+    if (tiempos_picos.empty()) {
+        cout << "\nAviso: --series y --hrv necesitan los instantes de los latidos, que este estimador no da" << endl;
+        return;
+    }
+    if (opciones.serie_bpm) mostrarSerieBPM(serieBPM(tiempos_picos, inicio, fin));
+    if (opciones.serie_vfc) mostrarSeriesVFC(tiempos_picos, opciones.reglas);
+}
+
+// Muestra el formato y el análisis de una grabación ya cargada; los picos se
+// informan en muestras del archivo completo. Si se indica ruta_filtrada, se
+// escribe ahí la señal filtrada (del canal representativo si hay varios)
+void analizarYMostrar(const Grabacion& audio, const OpcionesAnalisis& opciones = OpcionesAnalisis()) {
+    double umbral_picos = opciones.umbral_picos;
+    EstimadorBPM estimador = opciones.estimador;
+    const string& ruta_filtrada = opciones.ruta_filtrada;
+    mostrarFormato(audio);
+    if (audio.canales.empty() || audio.canales[0].empty())
+        throw runtime_error("La grabación no contiene muestras");
+    double inicio = audio.cuadro_inicio / audio.frecuencia_muestreo;
+    double fin = inicio + audio.canales[0].size() / audio.frecuencia_muestreo;
+
+    if (audio.canales.size() > 1) {
+        ResultadosMulticanal multicanal = analizarCanales(audio.canales, audio.frecuencia_muestreo, umbral_picos, estimador);
+        if (!ruta_filtrada.empty()) {
+            size_t c = multicanal.canal_representativo;
+            // Los estimadores sobre el espectro sin filtrar no reconstruyen la señal: solo entonces se filtra aquí
+            if (multicanal.senal_representativa.muestras.empty())
+                multicanal.senal_representativa = filtrarSenal(audio.canales[c], audio.frecuencia_muestreo);
+            escribirSenalFiltrada(ruta_filtrada, multicanal.senal_representativa, multicanal.por_canal[c].indices_picos);
+        }
+        for (auto& canal : multicanal.por_canal) {
+            for (size_t& indice : canal.indices_picos) indice += audio.cuadro_inicio;
+            for (double& tiempo : canal.tiempos_picos_segundos) tiempo += inicio;
+        }
+        mostrarResultadosMulticanal(multicanal, opciones.reglas);
+        size_t c = multicanal.canal_representativo;
+        mostrarSeries(multicanal.por_canal[c].tiempos_picos_segundos, inicio, fin, opciones);
+        if (opciones.verificar_cepstro)
+            verificarConCepstro(audio.canales[c], audio.frecuencia_muestreo, multicanal.por_canal[c], inicio);
+    } else {
+        ResultadosBPM resultados;
+        if (ruta_filtrada.empty()) {
+            resultados = analizarSenal(audio.canales[0], audio.frecuencia_muestreo, umbral_picos, estimador);
+        } else {
+            // Un solo espectro para el estimador y para la señal que se guarda
+            vector<complex<double>> espectro = obtenerEspectroParaFiltrado(audio.canales[0]);
+            if (usaEspectroSinFiltrar(estimador))
+                resultados = estimarBPMEspectro(espectro, audio.frecuencia_muestreo, estimador, audio.canales[0].size(),
+                                                umbral_picos);
+            filtrarFrecuencias(espectro, audio.frecuencia_muestreo);
+            SenalDecimada senal_filtrada = reconstruirFiltrada(espectro, audio.canales[0].size(), audio.frecuencia_muestreo);
+            if (!usaEspectroSinFiltrar(estimador)) resultados = estimarBPMDecimada(senal_filtrada, umbral_picos, estimador);
+            escribirSenalFiltrada(ruta_filtrada, senal_filtrada, resultados.indices_picos);
+        }
+        for (size_t& indice : resultados.indices_picos) indice += audio.cuadro_inicio;
+        for (double& tiempo : resultados.tiempos_picos_segundos) tiempo += inicio;
+        mostrarResultados(resultados, opciones.reglas);
+        mostrarSeries(resultados.tiempos_picos_segundos, inicio, fin, opciones);
+        if (opciones.verificar_cepstro) verificarConCepstro(audio.canales[0], audio.frecuencia_muestreo, resultados, inicio);
+    }
+}
+
+
 // ========== MAIN: INTEGRACIÓN COMPLETA ==========
-int main() {
+int main(int argc, char* argv[]) {
+    // Argumentos: [archivo.wav ...] [--from segundos] [--to segundos]
+    vector<string> archivos;
+    RangoTiempo rango = {0.0, numeric_limits<double>::infinity()};
+    bool usar_rango = false;
+    bool usar_io_uring = false;
+    unsigned int profundidad_cola = 16;
+    bool usar_crudo = false;
+    FormatoPCMCrudo formato_crudo;
+    bool usar_cache = true;
+    bool hash_completo = false;
+    OpcionesAnalisis opciones;
+    for (int i = 1; i < argc; i++) {
+        string argumento = argv[i];
+        if (argumento == "--io-uring") {
+            usar_io_uring = true;
+        } else if (argumento == "--no-cache") {
+            usar_cache = false;
+        } else if (argumento == "--cache-full-hash") {
+            hash_completo = true;
+        } else if (argumento == "--write-filtered") {
+            if (i + 1 >= argc) {
+                cerr << "Falta la ruta para --write-filtered" << endl;
+                return 1;
+            }
+            opciones.ruta_filtrada = argv[++i];
+        } else if (argumento == "--estimator") {
+            string nombre = i + 1 < argc ? argv[i + 1] : "";
+            if (nombre == "picos") opciones.estimador = EstimadorBPM::Picos;
+            else if (nombre == "espectral") opciones.estimador = EstimadorBPM::Espectral;
+            else if (nombre == "autocorrelacion") opciones.estimador = EstimadorBPM::Autocorrelacion;
+            else if (nombre == "cepstral") opciones.estimador = EstimadorBPM::Cepstral;
+            else if (nombre == "envolvente") opciones.estimador = EstimadorBPM::Envolvente;
+            else {
+                cerr << "Valor inválido para --estimator (picos, espectral, autocorrelacion, cepstral o envolvente)" << endl;
+                return 1;
+            }
+            i++;
+        } else if (argumento == "--series") {
+            opciones.serie_bpm = true;
+        } else if (argumento == "--cepstral-check") {
+            opciones.verificar_cepstro = true;
+        } else if (argumento == "--hrv") {
+            opciones.serie_vfc = true;
+        } else if (argumento == "--rules") {
+            if (i + 1 >= argc) {
+                cerr << "Falta la ruta para --rules" << endl;
+                return 1;
+            }
+            try {
+                opciones.reglas = MotorReglas::desdeArchivo(argv[++i]);
+            } catch (exception& e) {
+                cerr << e.what() << endl;
+                return 1;
+            }
+        } else if (argumento == "--threshold") {
+            if (i + 1 >= argc || !leerSegundos(argv[i + 1], opciones.umbral_picos) || opciones.umbral_picos > 1) {
+                cerr << "Valor inválido para --threshold" << endl;
+                return 1;
+            }
+            i++;
+        } else if (argumento == "--raw") {
+            usar_crudo = true;
+        } else if (argumento == "--rate" || argumento == "--channels") {
+            double valor;
+            if (i + 1 >= argc || !leerSegundos(argv[i + 1], valor) || valor < 1 || valor != floor(valor) ||
+                valor > numeric_limits<unsigned int>::max()) {
+                cerr << "Valor inválido para " << argumento << endl;
+                return 1;
+            }
+            (argumento == "--rate" ? formato_crudo.frecuencia_muestreo : formato_crudo.canales) = static_cast<unsigned int>(valor);
+            i++;
+        } else if (argumento == "--sample-format") {
+            string tipo = i + 1 < argc ? argv[i + 1] : "";
+            if (tipo == "s16") formato_crudo.tipo = FormatoMuestras::S16;
+            else if (tipo == "s32") formato_crudo.tipo = FormatoMuestras::S32;
+            else if (tipo == "f32") formato_crudo.tipo = FormatoMuestras::F32;
+            else {
+                cerr << "Valor inválido para --sample-format (s16, s32 o f32)" << endl;
+                return 1;
+            }
+            i++;
+        } else if (argumento == "--queue-depth") {
+            double valor;
+            if (i + 1 >= argc || !leerSegundos(argv[i + 1], valor) || valor < 1 || valor > 4096) {
+                cerr << "Valor inválido para --queue-depth" << endl;
+                return 1;
+            }
+            profundidad_cola = static_cast<unsigned int>(valor);
+            i++;
+        } else if (argumento == "--from" || argumento == "--to") {
+            double valor;
+            if (i + 1 >= argc || !leerSegundos(argv[i + 1], valor)) {
+                cerr << "Valor inválido para " << argumento << endl;
+                return 1;
+            }
+            (argumento == "--from" ? rango.inicio : rango.fin) = valor;
+            usar_rango = true;
+            i++;
+        } else {
+            archivos.push_back(argumento);
+        }
+    }
+    if (usar_rango && !(rango.fin > rango.inicio)) {
+        cerr << "El rango --from/--to está vacío" << endl;
+        return 1;
+    }
+    if (opciones.verificar_cepstro && opciones.estimador != EstimadorBPM::Picos) {
+        cerr << "--cepstral-check compara con los picos: requiere --estimator picos" << endl;
+        return 1;
+    }
+    if (usar_crudo && formato_crudo.frecuencia_muestreo == 0) {
+        cerr << "--raw requiere --rate" << endl;
+        return 1;
+    }
+
     cout << "================================================" << endl;
     cout << "  SISTEMA DE DETECCIÓN DE ANOMALÍAS CARDÍACAS" << endl;
     cout << "  Filtrado de Frecuencia Cardíaca con FFT" << endl;
@@ -709,41 +5802,213 @@ int main() {
     // Procesamiento de archivo WAV 
     cout << "\n========== PROCESAMIENTO DE ARCHIVO WAV ==========\n" << endl;
     
+    // En los lotes no se escribe la señal filtrada: todos los archivos compartirían la ruta
+    OpcionesAnalisis opciones_lote = opciones;
+    opciones_lote.ruta_filtrada.clear();
+
+    // Lote con io_uring: cada archivo se analiza en cuanto termina su lectura
+    if (usar_io_uring && !archivos.empty()) {
+        vector<string> rutas;
+        for (const auto& archivo : archivos) rutas.push_back(ruta_audio(archivo.c_str()));
+
+        LectorLoteUring lector(profundidad_cola);
+        if (!lector.usaIoUring()) cout << "io_uring no disponible, se usa stdio" << endl;
+
+        Grabacion audio;
+        lector.leer(rutas, [&](size_t k, const vector<uint8_t>& datos, const string& error) {
+            cout << "\n===== " << archivos[k] << " =====" << endl;
+            try {
+                if (!error.empty()) throw runtime_error(error);
+                WavStream flujo(BytesEnMemoria{datos.data(), datos.size()});
+                leerSegmento(flujo, rango, audio);
+                analizarYMostrar(audio, opciones_lote);
+            } catch (exception& e) {
+                cout << "Error procesando archivo: " << e.what() << endl;
+            }
+        });
+        return 0;
+    }
+
+    // Lote: el siguiente archivo se carga mientras se analiza el actual
+    if (archivos.size() > 1) {
+        vector<string> rutas;
+        for (const auto& archivo : archivos) rutas.push_back(ruta_audio(archivo.c_str()));
+
+        procesarLote(rutas, rango, [&](const string&, const BufferGrabacion& buffer) {
+            cout << "\n===== " << archivos[buffer.indice] << " =====" << endl;
+            if (!buffer.error.empty()) {
+                cout << "Error procesando archivo: " << buffer.error << endl;
+                return;
+            }
+            try {
+                analizarYMostrar(buffer.audio, opciones_lote);
+            } catch (exception& e) {
+                cout << "Error procesando archivo: " << e.what() << endl;
+            }
+        });
+        return 0;
+    }
+
     string nombre_archivo;
-    cout << "Ingrese nombre del archivo WAV (o 'skip' para omitir): ";
-    cin >> nombre_archivo;
+    if (archivos.empty()) {
+        cout << "Ingrese nombre del archivo WAV (o 'skip' para omitir): ";
+        cin >> nombre_archivo;
+    } else {
+        nombre_archivo = archivos[0];
+    }
     
     if (nombre_archivo != "skip") {
         try {
+            // Entrada estándar, FIFO o PCM crudo: se lee en secuencia, sin mapear ni buscar
+            if (nombre_archivo == "-" || usar_crudo || esFlujoSecuencial(ruta_audio(nombre_archivo.c_str()))) {
+                FILE* entrada = stdin;
+                if (nombre_archivo == "-") {
+#ifdef _WIN32
+                    _setmode(_fileno(stdin), _O_BINARY);
+#endif
+                } else {
+                    entrada = fopen(ruta_audio(nombre_archivo.c_str()).c_str(), "rb");
+                    if (!entrada) throw runtime_error("No se encuentra el audio");
+                }
+                unique_ptr<FILE, int (*)(FILE*)> cierre(entrada == stdin ? nullptr : entrada, fclose);
+
+                cout << "\nLeyendo flujo " << (usar_crudo ? "PCM crudo" : "WAV")
+                     << (isinf(rango.fin) ? " hasta el final (EOF)..." : " hasta --to...") << endl;
+                unique_ptr<WavStream> flujo = usar_crudo ? make_unique<WavStream>(entrada, formato_crudo)
+                                                         : make_unique<WavStream>(entrada);
+                Grabacion audio;
+                OpcionesAnalisis opciones_flujo = opciones;
+                if (opciones.serie_bpm) {
+                    // La serie se emite mientras llegan los bloques (del primer canal); el resumen, al final
+                    double fs = flujo->frecuenciaMuestreo();
+                    SerieBPMEnFlujo serie(fs, floor(rango.inicio * fs) / fs);
+                    vector<PuntoSerieBPM> puntos;
+                    cout << "\n--- SERIE DE BPM (en flujo) ---" << endl;
+                    cout << "Tiempo (s)\tBPM\tLatidos" << endl;
+                    leerSegmento(*flujo, rango, audio, [&](const vector<vector<double>>& bloque) {
+                        puntos.clear();
+                        serie.procesarBloque(bloque[0].data(), bloque[0].size(), puntos);
+                        for (const auto& punto : puntos) mostrarPuntoSerieBPM(punto);
+                    });
+                    puntos.clear();
+                    serie.finalizar(puntos);
+                    for (const auto& punto : puntos) mostrarPuntoSerieBPM(punto);
+                    opciones_flujo.serie_bpm = false;
+                } else {
+                    leerSegmento(*flujo, rango, audio);
+                }
+                cout << "Flujo leído: " << audio.canales[0].size() << " muestras desde la muestra "
+                     << audio.cuadro_inicio << endl;
+                analizarYMostrar(audio, opciones_flujo);
+                return 0;
+            }
+
+            // Si el audio ya se analizó con los mismos parámetros, se salta directo a los picos;
+            // con --from/--to solo se leen de la caché los trozos del tramo
+            // (el estimador espectral necesita el espectro sin filtrar, que la caché no guarda)
+            string ruta = ruta_audio(nombre_archivo.c_str());
+            const double fs_minima = 100.0;
+            bool espectral = usaEspectroSinFiltrar(opciones.estimador);
+            uint64_t hash_contenido = 0;
+            if (usar_cache && !espectral) {
+                hash_contenido = huellaContenido(ruta, hash_completo);
+                SenalDecimada senal_filtrada;
+                size_t primera = 0;
+                if (leerCacheDecimada(rutaCache(ruta), hash_contenido, hashParametrosPipeline(fs_minima), rango,
+                                      senal_filtrada, primera)) {
+                    cout << "\nSeñal filtrada leída de la caché: " << senal_filtrada.muestras.size() << " muestras a "
+                         << senal_filtrada.frecuencia_muestreo << " Hz";
+                    if (usar_rango) cout << " desde el tramo [" << rango.inicio << ", " << rango.fin << ") s";
+                    cout << endl;
+                    cout << "Extrayendo BPM..." << endl;
+                    ResultadosBPM resultados = estimarBPMDecimada(senal_filtrada, opciones.umbral_picos, opciones.estimador);
+                    if (!opciones.ruta_filtrada.empty()) {
+                        escribirSenalFiltrada(opciones.ruta_filtrada, senal_filtrada, resultados.indices_picos);
+                        cout << "Señal filtrada guardada en " << opciones.ruta_filtrada << endl;
+                    }
+                    double inicio = primera / senal_filtrada.frecuencia_muestreo;
+                    for (size_t& indice : resultados.indices_picos) indice += primera * senal_filtrada.factor;
+                    for (double& tiempo : resultados.tiempos_picos_segundos) tiempo += inicio;
+                    mostrarResultados(resultados, opciones.reglas);
+                    mostrarSeries(resultados.tiempos_picos_segundos, inicio,
+                                  inicio + senal_filtrada.muestras.size() / senal_filtrada.frecuencia_muestreo, opciones);
+                    if (opciones.verificar_cepstro) {
+                        // La caché no guarda la señal sin filtrar que necesita el cepstro: se lee el tramo
+                        Grabacion original = cargar_segmento_wav(nombre_archivo.c_str(), rango.inicio, rango.fin);
+                        verificarConCepstro(original.canales[0], original.frecuencia_muestreo, resultados,
+                                            original.cuadro_inicio / original.frecuencia_muestreo);
+                    }
+                    return 0;
+                }
+            }
+
+            if (usar_rango) {
+                cout << "\nCargando tramo [" << rango.inicio << ", " << rango.fin << ") s..." << endl;
+                Grabacion segmento = cargar_segmento_wav(nombre_archivo.c_str(), rango.inicio, rango.fin);
+                cout << "Tramo cargado: " << segmento.canales[0].size() << " muestras desde la muestra "
+                     << segmento.cuadro_inicio << endl;
+                analizarYMostrar(segmento, opciones);
+                return 0;
+            }
+
             cout << "\nCargando y normalizando audio..." << endl;
-            vector<double> senal = cargar_normalizar_wav(nombre_archivo.c_str());
-            cout << "Audio cargado: " << senal.size() << " muestras" << endl;
+            AudioMapeado audio(ruta);
+            size_t num_muestras = audio.numCuadros();
+            cout << "Audio cargado: " << num_muestras << " muestras" << endl;
+
+            Grabacion formato;
+            describirGrabacion(audio.wav(), formato);
+            double frecuencia_muestreo = formato.frecuencia_muestreo;
             
-            double frecuencia_muestreo = 44100.0;
+            if (audio.canales() > 1) {
+                cout << "\nAnalizando cada canal en paralelo..." << endl;
+                formato.canales = desentrelazarCanales(audio);
+                analizarYMostrar(formato, opciones);
+                return 0;
+            }
+            mostrarFormato(formato);
             
             cout << "\nAplicando FFT y filtrado..." << endl;
-            vector<complex<double>> espectro = obtenerEspectroParaFiltrado(senal);
+            vector<complex<double>> espectro = obtenerEspectroParaFiltrado(audio);
+            ResultadosBPM resultados;
+            if (espectral) {
+                cout << "Estimando BPM desde el espectro..." << endl;
+                resultados = estimarBPMEspectro(espectro, frecuencia_muestreo, opciones.estimador, num_muestras,
+                                                opciones.umbral_picos);
+                if (opciones.ruta_filtrada.empty()) {
+                    mostrarResultados(resultados, opciones.reglas);
+                    mostrarSeries(resultados.tiempos_picos_segundos, 0.0, num_muestras / frecuencia_muestreo, opciones);
+                    return 0;
+                }
+            }
             filtrarFrecuencias(espectro, frecuencia_muestreo);
             
-            cout << "Aplicando IFFT..." << endl;
-            vector<double> senal_filtrada = ifft_real(espectro);
-            senal_filtrada.resize(senal.size());
-            
-            cout << "Extrayendo BPM..." << endl;
-            ResultadosBPM resultados = extraerBPM(senal_filtrada, frecuencia_muestreo);
-            
-            cout << "\n--- RESULTADOS ---" << endl;
-            cout << "BPM promedio: " << resultados.bpm_promedio << endl;
-            cout << "Picos detectados: " << resultados.indices_picos.size() << endl;
-            cout << "Intervalos RR: " << resultados.intervalos_rr_segundos.size() << endl;
-            
-            cout << "\nDetectando anomalías..." << endl;
-            Anomalias anomalias = detectarAnomalias(resultados);
+            cout << "Aplicando IFFT decimada..." << endl;
+            SenalDecimada senal_filtrada = ifft_real_decimada(espectro, frecuencia_muestreo, fs_minima);
+            senal_filtrada.muestras.resize((num_muestras + senal_filtrada.factor - 1) / senal_filtrada.factor);
+            cout << "Señal filtrada: " << senal_filtrada.muestras.size() << " muestras a "
+                 << senal_filtrada.frecuencia_muestreo << " Hz" << endl;
+
+            if (usar_cache && !espectral) {
+                try {
+                    escribirCacheDecimada(rutaCache(ruta), senal_filtrada, hash_contenido,
+                                          hashParametrosPipeline(fs_minima), num_muestras, &espectro);
+                } catch (exception& e) {
+                    cout << "Aviso: " << e.what() << endl;   // el análisis sigue sin caché
+                }
+            }
             
-            cout << "\n--- DIAGNÓSTICO ---" << endl;
-            for (const auto& alerta : anomalias.lista_alertas) {
-                cout << "• " << alerta << endl;
+            if (!espectral) {
+                cout << "Extrayendo BPM..." << endl;
+                resultados = estimarBPMDecimada(senal_filtrada, opciones.umbral_picos, opciones.estimador);
             }
+            if (!opciones.ruta_filtrada.empty()) {
+                escribirSenalFiltrada(opciones.ruta_filtrada, senal_filtrada, resultados.indices_picos);
+                cout << "Señal filtrada guardada en " << opciones.ruta_filtrada << endl;
+            }
+            mostrarResultados(resultados, opciones.reglas);
+            mostrarSeries(resultados.tiempos_picos_segundos, 0.0, num_muestras / frecuencia_muestreo, opciones);
+            if (opciones.verificar_cepstro) verificarConCepstro(desentrelazarCanales(audio)[0], frecuencia_muestreo, resultados);
             
         } catch (exception& e) {
             cout << "Error procesando archivo: " << e.what() << endl;
@@ -751,4 +6016,4 @@ int main() {
     }
 
     return 0;
-}
\ No newline at end of file
+}